@@ -0,0 +1,221 @@
+#include "devices/lapic.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/pte.h"
+#include "threads/vaddr.h"
+
+/* Interface to the local APIC, the interrupt controller built
+   into each CPU.  Refer to [IA32-v3a] chapter 10 "Advanced
+   Programmable Interrupt Controller (APIC)" for details.
+
+   Every CPU sees its own local APIC at the same physical
+   address, so the one mapping made by lapic_init() serves them
+   all.  Device interrupts keep coming from the 8259A PICs, which
+   are wired to the boot CPU's LINT0 pin ("virtual wire mode"), so
+   no I/O APIC needs to be programmed.  The local APIC is used for
+   inter-processor interrupts and for a periodic timer interrupt
+   on the other CPUs. */
+
+/* Local APIC registers, as byte offsets from its base. */
+#define LAPIC_ID        0x020   /* Local APIC ID. */
+#define LAPIC_TPR       0x080   /* Task priority. */
+#define LAPIC_EOI       0x0b0   /* End of interrupt. */
+#define LAPIC_SVR       0x0f0   /* Spurious interrupt vector. */
+#define LAPIC_ICR_LO    0x300   /* Interrupt command, bits 0...31. */
+#define LAPIC_ICR_HI    0x310   /* Interrupt command, bits 32...63. */
+#define LAPIC_LVT_TIMER 0x320   /* Local vector table: timer. */
+#define LAPIC_LVT_LINT0 0x350   /* Local vector table: LINT0 pin. */
+#define LAPIC_LVT_LINT1 0x360   /* Local vector table: LINT1 pin. */
+#define LAPIC_LVT_ERROR 0x370   /* Local vector table: errors. */
+#define LAPIC_TIMER_INIT 0x380  /* Timer initial count. */
+#define LAPIC_TIMER_CUR 0x390   /* Timer current count. */
+#define LAPIC_TIMER_DIV 0x3e0   /* Timer divide configuration. */
+
+/* Register bits. */
+#define SVR_ENABLE      0x00000100 /* APIC software enable. */
+#define LVT_MASKED      0x00010000 /* Interrupt masked. */
+#define LVT_PERIODIC    0x00020000 /* Timer: periodic mode. */
+#define LVT_NMI         0x00000400 /* Delivery mode: NMI. */
+#define LVT_EXTINT      0x00000700 /* Delivery mode: ExtINT. */
+#define ICR_INIT        0x00000500 /* Delivery mode: INIT. */
+#define ICR_STARTUP     0x00000600 /* Delivery mode: start-up. */
+#define ICR_PENDING     0x00001000 /* Delivery status: send pending. */
+#define ICR_ASSERT      0x00004000 /* Level: assert. */
+#define ICR_LEVEL       0x00008000 /* Trigger mode: level. */
+#define TIMER_DIV_16    0x00000003 /* Timer counts bus clock / 16. */
+
+/* Ticks to calibrate the timer over. */
+#define LAPIC_CALIBRATE_TICKS 10
+
+/* Local APIC registers, mapped by lapic_init(). */
+static volatile uint32_t *lapic;
+
+/* Local APIC timer counts per timer tick, set by
+   lapic_calibrate(). */
+static uint32_t lapic_timer_count;
+
+static uint32_t lapic_read (int reg);
+static void lapic_write (int reg, uint32_t value);
+static void lapic_icr (uint8_t apic_id, uint32_t low);
+
+/* Maps the local APIC registers at physical address PADDR into
+   the kernel's page tables and enables the boot CPU's local
+   APIC, leaving the PICs' interrupts routed through LINT0.
+
+   The registers are mapped uncached at virtual address PADDR,
+   which lies above all of the kernel's mappings of RAM.  This
+   must happen before the first user process is created, because
+   pagedir_create() copies the kernel's page directory. */
+void
+lapic_init (uintptr_t paddr)
+{
+  void *vaddr = (void *) paddr;
+  uint32_t *pt;
+
+  ASSERT (pg_ofs (vaddr) == 0);
+  ASSERT (is_kernel_vaddr (vaddr));
+  ASSERT (init_page_dir[pd_no (vaddr)] == 0);
+
+  pt = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+  pt[pt_no (vaddr)] = paddr | PTE_P | PTE_W | PTE_PWT | PTE_PCD;
+  init_page_dir[pd_no (vaddr)] = pde_create (pt);
+  lapic = vaddr;
+
+  lapic_write (LAPIC_SVR, SVR_ENABLE | LAPIC_SPURIOUS_VEC);
+  lapic_write (LAPIC_TPR, 0);
+  lapic_write (LAPIC_LVT_TIMER, LVT_MASKED | LAPIC_TIMER_VEC);
+  lapic_write (LAPIC_LVT_LINT0, LVT_EXTINT);
+  lapic_write (LAPIC_LVT_LINT1, LVT_NMI);
+  lapic_write (LAPIC_LVT_ERROR, LVT_MASKED | LAPIC_SPURIOUS_VEC);
+}
+
+/* Enables the local APIC of the application processor we are
+   running on and starts its periodic timer interrupt, at the
+   rate of the PIT's.  Interrupts must be off. */
+void
+lapic_init_ap (void)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (lapic_timer_count != 0);
+
+  lapic_write (LAPIC_SVR, SVR_ENABLE | LAPIC_SPURIOUS_VEC);
+  lapic_write (LAPIC_TPR, 0);
+  lapic_write (LAPIC_LVT_LINT0, LVT_MASKED);
+  lapic_write (LAPIC_LVT_LINT1, LVT_MASKED);
+  lapic_write (LAPIC_LVT_ERROR, LVT_MASKED | LAPIC_SPURIOUS_VEC);
+  lapic_write (LAPIC_TIMER_DIV, TIMER_DIV_16);
+  lapic_write (LAPIC_LVT_TIMER, LVT_PERIODIC | LAPIC_TIMER_VEC);
+  lapic_write (LAPIC_TIMER_INIT, lapic_timer_count);
+}
+
+/* Measures the local APIC timer's rate against the timer tick.
+   All of the local APICs count the same bus clock, so the boot
+   CPU measures for all of them.  Interrupts must be on. */
+void
+lapic_calibrate (void)
+{
+  uint32_t counted;
+  int64_t start;
+
+  ASSERT (intr_get_level () == INTR_ON);
+
+  lapic_write (LAPIC_TIMER_DIV, TIMER_DIV_16);
+  lapic_write (LAPIC_LVT_TIMER, LVT_MASKED | LAPIC_TIMER_VEC);
+
+  /* Wait for a timer tick, then count over
+     LAPIC_CALIBRATE_TICKS ticks. */
+  start = timer_ticks ();
+  while (timer_ticks () == start)
+    continue;
+  lapic_write (LAPIC_TIMER_INIT, UINT32_MAX);
+  start = timer_ticks ();
+  while (timer_ticks () - start < LAPIC_CALIBRATE_TICKS)
+    continue;
+  counted = UINT32_MAX - lapic_read (LAPIC_TIMER_CUR);
+  lapic_write (LAPIC_TIMER_INIT, 0);
+
+  lapic_timer_count = counted / LAPIC_CALIBRATE_TICKS;
+  if (lapic_timer_count == 0)
+    lapic_timer_count = 1;
+  printf ("Calibrating local APIC timer...  %'"PRIu32" counts/tick.\n",
+          lapic_timer_count);
+}
+
+/* Signals the end of the interrupt being handled to the local
+   APIC, so that it will deliver further interrupts. */
+void
+lapic_eoi (void)
+{
+  lapic_write (LAPIC_EOI, 0);
+}
+
+/* Sends interrupt VEC to the CPU whose local APIC ID is
+   APIC_ID. */
+void
+lapic_send_ipi (uint8_t apic_id, uint8_t vec)
+{
+  lapic_icr (apic_id, vec);
+}
+
+/* Starts the application processor whose local APIC ID is
+   APIC_ID running in real mode at physical address PADDR, which
+   must be page-aligned and below 1 MB, by sending it an INIT
+   interrupt followed by two start-up interrupts, as in [MP]
+   appendix B.4 "Application Processor Startup".  Interrupts
+   must be on, for the delays. */
+void
+lapic_start_ap (uint8_t apic_id, uintptr_t paddr)
+{
+  int i;
+
+  ASSERT (paddr % PGSIZE == 0 && paddr < 0x100000);
+
+  lapic_icr (apic_id, ICR_INIT | ICR_LEVEL | ICR_ASSERT);
+  timer_udelay (200);
+  lapic_icr (apic_id, ICR_INIT | ICR_LEVEL);
+  timer_mdelay (10);
+  for (i = 0; i < 2; i++)
+    {
+      lapic_icr (apic_id, ICR_STARTUP | (paddr >> 12));
+      timer_udelay (200);
+    }
+}
+
+/* Returns the value of local APIC register REG. */
+static uint32_t
+lapic_read (int reg)
+{
+  return lapic[reg / sizeof *lapic];
+}
+
+/* Sets local APIC register REG to VALUE. */
+static void
+lapic_write (int reg, uint32_t value)
+{
+  lapic[reg / sizeof *lapic] = value;
+}
+
+/* Sends an interrupt command with low word LOW to the CPU whose
+   local APIC ID is APIC_ID, and waits until it has been sent.
+   The two halves of the command register are written with
+   interrupts off, so that an interrupt handler's IPI cannot come
+   between them. */
+static void
+lapic_icr (uint8_t apic_id, uint32_t low)
+{
+  enum intr_level old_level;
+
+  ASSERT (lapic != NULL);
+
+  old_level = intr_disable ();
+  lapic_write (LAPIC_ICR_HI, (uint32_t) apic_id << 24);
+  lapic_write (LAPIC_ICR_LO, low);
+  while (lapic_read (LAPIC_ICR_LO) & ICR_PENDING)
+    continue;
+  intr_set_level (old_level);
+}
@@ -0,0 +1,20 @@
+#ifndef DEVICES_LAPIC_H
+#define DEVICES_LAPIC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Interrupt vectors delivered by the local APIC.  They lie above
+   everything the 8259A PICs and the system call use. */
+#define LAPIC_TIMER_VEC    0xf0 /* Local APIC timer. */
+#define LAPIC_RESCHED_VEC  0xf1 /* Reschedule inter-processor interrupt. */
+#define LAPIC_SPURIOUS_VEC 0xff /* Spurious interrupt. */
+
+void lapic_init (uintptr_t paddr);
+void lapic_init_ap (void);
+void lapic_calibrate (void);
+void lapic_eoi (void);
+void lapic_send_ipi (uint8_t apic_id, uint8_t vec);
+void lapic_start_ap (uint8_t apic_id, uintptr_t paddr);
+
+#endif /* devices/lapic.h */
@@ -5,8 +5,10 @@
 #include <stdio.h>
 #include "devices/pit.h"
 #include "threads/interrupt.h"
+#include "threads/profile.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/workqueue.h"
 
 /* See [8254] for hardware details of the 8254 timer chip. */
 
@@ -24,17 +26,120 @@ static int64_t ticks;
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+/* Hierarchical timing wheel of armed timer events.  Level L has
+   WHEEL_SLOTS slots, each covering WHEEL_SLOTS**L ticks, so the
+   wheel as a whole spans
+   WHEEL_SLOTS**WHEEL_LEVELS ticks.  An event is placed on the
+   lowest level whose span covers its remaining delay.  Whenever
+   the slot index of a level wraps around to 0, the current slot
+   of the next level up is emptied and its events are reinserted
+   ("cascaded") on lower levels.  Events in a level-0 slot all
+   expire on the same tick, so they are fired together. */
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS 4
+static struct list wheel[WHEEL_LEVELS][WHEEL_SLOTS];
+static int64_t wheel_next;      /* Next tick the wheel will process. */
+
+/* While wheel_advance() fires the events due on a tick, the
+   batch that wake_sleeper() adds the threads it wakes to, so
+   that the waker yields at most once per tick however many
+   sleepers expire on it. */
+static struct wake_batch *wheel_batch;
+
+/* Timer events are normally fired by a kernel worker thread,
+   which the timer interrupt handler queues wheel_work to wake
+   whenever the wheel has work due, so that the handler itself
+   does a bounded amount of work.  If timer_inline_events is
+   true, the handler fires them itself instead.
+   Controlled by kernel command-line option "-inline-timers". */
+bool timer_inline_events;
+static struct work wheel_work;
+
+/* Time spent in the timer interrupt handler, which runs with
+   interrupts off, in TSC cycles.  Measured once the TSC has been
+   calibrated. */
+static long long intr_cnt;      /* # of interrupts measured. */
+static uint64_t intr_cycles;    /* Total cycles in handler. */
+static uint64_t intr_cycles_max; /* Most cycles in one interrupt. */
+
+/* PIT cycles per timer tick. */
+#define PIT_TICK_COUNT ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+
+#define NSEC_PER_SEC 1000000000
+
+/* Time stamp counter (TSC), calibrated against the PIT by
+   timer_calibrate().  Until then tsc_hz is 0, timer_now_ns()
+   has only tick resolution, and the PIT is never switched out
+   of periodic mode. */
+#define TSC_CALIBRATE_TICKS 5   /* Ticks to calibrate over. */
+static uint64_t tsc_hz;         /* TSC cycles per second. */
+static uint64_t tsc_per_tick;   /* TSC cycles per timer tick. */
+static uint64_t tsc_base;       /* TSC value at calibration... */
+static int64_t tsc_base_ns;     /* ...and timer_now_ns() then. */
+
+/* Timer interrupt programming.  Normally the PIT interrupts
+   periodically, once per tick.  It is switched to one-shot mode
+   when an interrupt is wanted at some other time: between ticks
+   for a high-resolution sleeper, or several ticks away while the
+   idle thread has stopped the tick.  In one-shot mode ticks are
+   accounted from the TSC, with tick `ticks + 1' due when the TSC
+   reaches next_tick_tsc. */
+static bool pit_oneshot;        /* PIT in one-shot mode? */
+static uint64_t next_tick_tsc;  /* TSC value at which next tick is due. */
+
+/* Dynamic ticks.  If true, the idle thread stops the periodic
+   timer interrupt while nothing is due and has the PIT interrupt
+   once, at the next tick that has work to do.
+   Controlled by kernel command-line option "-tickless". */
+bool timer_tickless;
+static bool idle_stopped;       /* Tick stopped by the idle thread? */
+static int64_t idle_deadline;   /* Tick at which it must restart. */
+static long long idle_stops;    /* # of times the tick was stopped. */
+static long long ticks_skipped; /* # of timer interrupts avoided. */
+
+/* A thread in a high-resolution (shorter than one tick) sleep. */
+struct hr_sleeper
+  {
+    uint64_t deadline;          /* TSC value at which to wake. */
+    struct thread *thread;      /* Sleeping thread. */
+    struct list_elem elem;      /* Element in hr_sleepers. */
+  };
+
+/* High-resolution sleepers, in order of increasing deadline.
+   There are never many, since each sleeps less than a tick. */
+static struct list hr_sleepers;
+static long long hr_wakeups;    /* # of high-resolution wakeups. */
+
 static intr_handler_func timer_interrupt;
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
 static void real_time_delay (int64_t num, int32_t denom);
+static void timer_calibrate_tsc (void);
+static void wheel_insert (struct timer_event *);
+static void wheel_advance (void);
+static int64_t wheel_next_event (int64_t limit);
+static void timer_tick_once (void);
+static work_func wheel_run;
+static void clock_program (uint64_t now, bool at_tick);
+static void hr_sleep (int64_t ns);
+static void hr_expire (uint64_t now);
 
 /* Sets up the timer to interrupt TIMER_FREQ times per second,
    and registers the corresponding interrupt. */
 void
 timer_init (void) 
 {
+  int level, slot;
+
+  for (level = 0; level < WHEEL_LEVELS; level++)
+    for (slot = 0; slot < WHEEL_SLOTS; slot++)
+      list_init (&wheel[level][slot]);
+  list_init (&hr_sleepers);
+  work_init (&wheel_work, wheel_run, NULL, WORK_PRI_HIGH);
+
   pit_configure_channel (0, 2, TIMER_FREQ);
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
@@ -64,6 +169,42 @@ timer_calibrate (void)
       loops_per_tick |= test_bit;
 
   printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
+
+  timer_calibrate_tsc ();
+}
+
+/* Measures the TSC rate against the periodic PIT interrupt and
+   starts timer_now_ns() from the current tick. */
+static void
+timer_calibrate_tsc (void) 
+{
+  enum intr_level old_level;
+  uint64_t start_tsc, end_tsc;
+  int64_t start;
+
+  /* Wait for a timer tick. */
+  start = ticks;
+  while (ticks == start)
+    barrier ();
+
+  /* Count TSC cycles over TSC_CALIBRATE_TICKS ticks. */
+  start_tsc = timer_rdtsc ();
+  start = ticks;
+  while (ticks - start < TSC_CALIBRATE_TICKS)
+    barrier ();
+  end_tsc = timer_rdtsc ();
+  if (end_tsc <= start_tsc)
+    return;
+
+  old_level = intr_disable ();
+  tsc_per_tick = (end_tsc - start_tsc) / TSC_CALIBRATE_TICKS;
+  tsc_hz = tsc_per_tick * PIT_HZ / PIT_TICK_COUNT;
+  tsc_base = end_tsc;
+  tsc_base_ns = (start + TSC_CALIBRATE_TICKS) * (NSEC_PER_SEC / TIMER_FREQ);
+  next_tick_tsc = end_tsc + tsc_per_tick;
+  intr_set_level (old_level);
+
+  printf ("Calibrating TSC...  %'"PRIu64" Hz.\n", tsc_hz);
 }
 
 /* Returns the number of timer ticks since the OS booted. */
@@ -76,6 +217,24 @@ timer_ticks (void)
   return t;
 }
 
+/* Returns the number of nanoseconds since the OS booted.  The
+   value never decreases.  Once timer_calibrate() has run, it is
+   derived from the CPU's time stamp counter and has much finer
+   resolution than a timer tick. */
+int64_t
+timer_now_ns (void) 
+{
+  uint64_t cycles;
+
+  if (tsc_hz == 0)
+    return timer_ticks () * (NSEC_PER_SEC / TIMER_FREQ);
+
+  cycles = timer_rdtsc () - tsc_base;
+  return (tsc_base_ns
+          + cycles / tsc_hz * NSEC_PER_SEC
+          + cycles % tsc_hz * NSEC_PER_SEC / tsc_hz);
+}
+
 /* Returns the number of timer ticks elapsed since THEN, which
    should be a value once returned by timer_ticks(). */
 int64_t
@@ -84,93 +243,98 @@ timer_elapsed (int64_t then)
   return timer_ticks () - then;
 }
 
+/* Initializes EVENT, which is not armed, to call FUNC(AUX) when
+   it fires. */
+void
+timer_event_init (struct timer_event *event, timer_event_func *func,
+                  void *aux)
+{
+  ASSERT (event != NULL);
+  ASSERT (func != NULL);
+
+  event->func = func;
+  event->aux = aux;
+  event->armed = false;
+}
 
+/* Arms EVENT, which must not already be armed, to fire at the
+   first timer tick at or after EXPIRES.  If EXPIRES has already
+   passed, EVENT fires at the next tick.
 
+   This function may be called from an interrupt handler. */
+void
+timer_event_arm (struct timer_event *event, int64_t expires)
+{
+  enum intr_level old_level;
 
+  ASSERT (event != NULL);
+  ASSERT (!event->armed);
 
+  old_level = intr_disable ();
+  event->expires = expires;
+  event->armed = true;
+  wheel_insert (event);
 
-/////////////////////////////////////
-// prj1(wait) - sungmin oh - start //
-// compare wakeup_tick between two list_elem
-// if wakeup_ticks of first parameter is less than or equal to one of second parameter, return true. else return false.
-// it is used as third parameter of list_insert_ordered
-bool
-less_wakeup_ticks(const struct list_elem* A, const struct list_elem* B, void* aux_unused){
-  // convert type from list_elem to struct thread (ref. /lib/kernel/list.h)
-  struct thread* a = list_entry(A, struct thread, elem);
-  struct thread* b = list_entry(B, struct thread, elem);
-  // compare wakeup_ticks between two inputs
-  return a->wakeup_ticks <= b->wakeup_ticks;
-  // actually, aux_unused is not used. it can be occur warning.
+  /* An interrupt handler may arm an event while the idle thread
+     has stopped the tick.  Bring the restart forward if so. */
+  if (idle_stopped && expires < idle_deadline)
+    {
+      idle_deadline = expires > ticks + 1 ? expires : ticks + 1;
+      clock_program (timer_rdtsc (), false);
+    }
+  intr_set_level (old_level);
 }
 
+/* Disarms EVENT.  Returns true if EVENT was armed, false if it
+   had already fired or was never armed.
 
-// wake up from wait list
-void
-timer_wakeup(void){
-  struct thread* t;
-
-  // use while loop to wake up all of the threads which should wake up at once
-  while(!list_empty(wait_list_ptr())){ // casting (int) can be needed
-    // convert type from list_elem to struct thread (ref. /lib/kernel/list.h)
-    // we only need to check from front because we insert threads by increasing order.
-    t = list_entry(list_front(wait_list_ptr()), struct thread, elem);
-    // if the front element is time to wake up, wake it up and go to beginning of while loop again. else no other elements are not time to wake up. so break out from while loop.
-    if(t->wakeup_ticks <= ticks){
-      list_pop_front(wait_list_ptr());
-      thread_unblock(t);
-    } else{
-      break;
+   This function may be called from an interrupt handler. */
+bool
+timer_event_cancel (struct timer_event *event)
+{
+  enum intr_level old_level;
+  bool was_armed;
+
+  ASSERT (event != NULL);
+
+  old_level = intr_disable ();
+  was_armed = event->armed;
+  if (was_armed)
+    {
+      list_remove (&event->elem);
+      event->armed = false;
     }
+  intr_set_level (old_level);
 
-  }
+  return was_armed;
 }
-// prj1(wait) - sungmin oh - end //
-///////////////////////////////////
-
 
+/* Timer event function for timer_sleep(): wakes up thread T. */
+static void
+wake_sleeper (void *t) 
+{
+  wake_batch_add (wheel_batch, t);
+}
 
 /* Sleeps for approximately TICKS timer ticks.  Interrupts must
    be turned on. */
 void
 timer_sleep (int64_t ticks) 
 {
-  int64_t start = timer_ticks ();
-
+  struct timer_event wakeup;
+  enum intr_level old_level;
 
-  /////////////////////////////////////
-  // prj1(wait) - sungmin oh - start //
-  // disable interrupt for a while (ref. /threads/interrupt.c)
-  enum intr_level old_level = intr_disable();
-  // we are going to store current thread in the wait list 
-  struct thread* t = thread_current();
-  // set wakeup_ticks of the current thread
-  t->wakeup_ticks = start + ticks;
-  // insert the current thread in wait list by increasing order of wakeup_ticks (ref. /lib/kernel/list.c)
-  list_insert_ordered(wait_list_ptr(), &t->elem, less_wakeup_ticks, NULL);
-  // block current thread;
-  thread_block();
-  // restore interrupt status
-  intr_set_level(old_level);
-
-
-/* original code. no need anymore.
- *
   ASSERT (intr_get_level () == INTR_ON);
-  while (timer_elapsed (start) < ticks) 
-    thread_yield ();
-*
-*/
-
-  // prj1(wait) - sungmin oh - end //
-  ///////////////////////////////////
-
+  if (ticks <= 0)
+    return;
 
+  timer_event_init (&wakeup, wake_sleeper, thread_current ());
+  old_level = intr_disable ();
+  timer_event_arm (&wakeup, ticks + timer_ticks ());
+  thread_block ();
+  intr_set_level (old_level);
 }
 
-
-
-
 /* Sleeps for approximately MS milliseconds.  Interrupts must be
    turned on. */
 void
@@ -239,24 +403,389 @@ void
 timer_print_stats (void) 
 {
   printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
+  if (timer_tickless)
+    printf ("Timer: %lld tickless idle periods, %lld interrupts skipped\n",
+            idle_stops, ticks_skipped);
+  if (hr_wakeups > 0)
+    printf ("Timer: %lld high-resolution wakeups\n", hr_wakeups);
+  if (intr_cnt > 0)
+    printf ("Timer: %"PRIu64" cycles average, %"PRIu64" cycles max "
+            "in interrupt handler\n",
+            intr_cycles / intr_cnt, intr_cycles_max);
 }
 
+/* Called by the idle thread, with interrupts off, just before it
+   halts the CPU.  In tickless mode, if no timer work is due on
+   the next tick, stops the periodic timer interrupt until the
+   first tick that has work.
+
+   The stop never crosses a second boundary, so that the
+   once-per-second work in thread_tick() is not skipped even if
+   some other interrupt ends the idle period early. */
+void
+timer_idle_enter (void) 
+{
+  int64_t limit, deadline;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!timer_tickless || tsc_hz == 0 || idle_stopped)
+    return;
+
+  limit = ticks - ticks % TIMER_FREQ + TIMER_FREQ;
+  deadline = wheel_next_event (limit);
+  if (deadline <= ticks + 1)
+    return;
+
+  idle_stopped = true;
+  idle_deadline = deadline;
+  idle_stops++;
+  clock_program (timer_rdtsc (), false);
+}
+
+/* Called by the idle thread after the CPU wakes up from halt,
+   and by the scheduler whenever it switches away from the idle
+   thread.  If some interrupt other than the timer ended a
+   tickless idle period, brings `ticks' up to date from the TSC
+   and restarts the regular tick. */
+void
+timer_idle_exit (void) 
+{
+  enum intr_level old_level = intr_disable ();
+
+  if (idle_stopped)
+    {
+      uint64_t now = timer_rdtsc ();
+
+      /* Nothing on the timing wheel is due before idle_deadline,
+         so it is enough to bump the tick count here; the wheel
+         catches up at the next timer interrupt.  If the deadline
+         itself has passed, the timer interrupt is pending and
+         will account for it. */
+      idle_stopped = false;
+      while (now >= next_tick_tsc && ticks + 1 < idle_deadline)
+        {
+          ticks++;
+          ticks_skipped++;
+          next_tick_tsc += tsc_per_tick;
+        }
+      clock_program (now, false);
+    }
+
+  intr_set_level (old_level);
+}
+
 /* Timer interrupt handler. */
 static void
-timer_interrupt (struct intr_frame *args UNUSED)
+timer_interrupt (struct intr_frame *args)
+{
+  uint64_t now, cycles;
+
+  if (profile_enabled)
+    profile_sample (args);
+
+  if (tsc_hz == 0)
+    {
+      timer_tick_once ();
+      return;
+    }
+
+  now = timer_rdtsc ();
+  if (!pit_oneshot)
+    {
+      timer_tick_once ();
+      next_tick_tsc = now + tsc_per_tick;
+      hr_expire (now);
+      clock_program (now, true);
+    }
+  else
+    {
+      /* Account for every tick that has come due.  The PIT and
+         TSC do not agree perfectly, so allow a few PIT cycles of
+         slack rather than taking a second interrupt for a tick
+         that is due a moment from now. */
+      uint64_t slack = 2 * tsc_hz / PIT_HZ;
+      int64_t passed = 0;
+
+      while (now + slack >= next_tick_tsc)
+        {
+          timer_tick_once ();
+          next_tick_tsc += tsc_per_tick;
+          passed++;
+        }
+      if (passed > 1)
+        ticks_skipped += passed - 1;
+      if (idle_stopped && ticks >= idle_deadline)
+        idle_stopped = false;
+
+      hr_expire (now);
+      clock_program (now, passed > 0);
+    }
+
+  cycles = timer_rdtsc () - now;
+  intr_cnt++;
+  intr_cycles += cycles;
+  if (cycles > intr_cycles_max)
+    intr_cycles_max = cycles;
+}
+
+/* Advances the clock by one tick and does that tick's work.
+   Timer events that have come due are fired here only if
+   timer_inline_events is true; otherwise they are handed to a
+   worker thread, and the wheel is merely moved along if nothing
+   is due. */
+static void
+timer_tick_once (void) 
 {
   ticks++;
- 
-  ///////////////////////////////
-  // prj1 - sungmin oh - start //
-  // check wait list every tick time
-  timer_wakeup();
-  // prj1 - sungmin oh - end //
-  /////////////////////////////
-  
+  if (timer_inline_events) 
+    {
+      while (wheel_next <= ticks)
+        wheel_advance ();
+    }
+  else if (wheel_next_event (ticks + 1) <= ticks)
+    work_queue (&wheel_work);
+  else
+    wheel_next = ticks + 1;
   thread_tick ();
 }
 
+/* Work function for wheel_work: processes every tick up to the
+   current one, firing the timer events that are due.  Each tick
+   is processed with interrupts off, but interrupts are let in
+   between ticks. */
+static void
+wheel_run (void *aux UNUSED) 
+{
+  enum intr_level old_level = intr_disable ();
+
+  while (wheel_next <= ticks) 
+    {
+      wheel_advance ();
+      intr_set_level (old_level);
+      intr_disable ();
+    }
+  intr_set_level (old_level);
+}
+
+/* Programs the PIT to interrupt at the earliest of: the next
+   tick (or, while the idle thread has stopped the tick, the
+   tick it must restart at) and the first high-resolution
+   sleeper's deadline.  NOW is the current TSC value.  AT_TICK
+   is true if a tick has just been accounted, in which case the
+   PIT may return to periodic mode without shifting the phase of
+   the tick noticeably.  Interrupts must be off. */
+static void
+clock_program (uint64_t now, bool at_tick)
+{
+  uint64_t target = next_tick_tsc;
+  bool need_oneshot = false;
+  uint64_t cycles;
+  unsigned count;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (tsc_hz != 0);
+
+  if (idle_stopped)
+    {
+      target = next_tick_tsc + (idle_deadline - ticks - 1) * tsc_per_tick;
+      need_oneshot = true;
+    }
+  if (!list_empty (&hr_sleepers))
+    {
+      struct hr_sleeper *first = list_entry (list_front (&hr_sleepers),
+                                             struct hr_sleeper, elem);
+      if (first->deadline < target)
+        target = first->deadline;
+      need_oneshot = true;
+    }
+
+  if (!need_oneshot)
+    {
+      /* The regular tick is all we need.  Return to periodic mode
+         at a tick; otherwise run one-shot up to the next tick. */
+      if (!pit_oneshot)
+        return;
+      if (at_tick)
+        {
+          pit_configure_channel (0, 2, TIMER_FREQ);
+          pit_oneshot = false;
+          next_tick_tsc = now + tsc_per_tick;
+          return;
+        }
+    }
+
+  /* Convert to PIT cycles, rounding up so that we are not early.
+     A count too large for the PIT just means an early interrupt,
+     after which we program the rest. */
+  cycles = target > now ? target - now : 0;
+  if (cycles >= tsc_per_tick * (0x10000 / PIT_TICK_COUNT))
+    count = 0xffff;
+  else
+    {
+      count = (cycles * PIT_HZ + tsc_hz - 1) / tsc_hz;
+      if (count < 1)
+        count = 1;
+      else if (count > 0xffff)
+        count = 0xffff;
+    }
+  pit_start_oneshot (0, count);
+  pit_oneshot = true;
+}
+
+/* Returns true if high-resolution sleeper A's deadline precedes
+   B's. */
+static bool
+hr_sleeper_less (const struct list_elem *a_, const struct list_elem *b_,
+                 void *aux UNUSED) 
+{
+  const struct hr_sleeper *a = list_entry (a_, struct hr_sleeper, elem);
+  const struct hr_sleeper *b = list_entry (b_, struct hr_sleeper, elem);
+
+  return a->deadline < b->deadline;
+}
+
+/* Blocks the current thread for NS nanoseconds, which should be
+   less than a tick, and arranges for a one-shot timer interrupt
+   to wake it. */
+static void
+hr_sleep (int64_t ns) 
+{
+  struct hr_sleeper sleeper;
+  enum intr_level old_level;
+  uint64_t now = timer_rdtsc ();
+
+  ASSERT (tsc_hz != 0);
+
+  sleeper.deadline = (now
+                      + ns / NSEC_PER_SEC * tsc_hz
+                      + ns % NSEC_PER_SEC * tsc_hz / NSEC_PER_SEC);
+  sleeper.thread = thread_current ();
+
+  old_level = intr_disable ();
+  list_insert_ordered (&hr_sleepers, &sleeper.elem, hr_sleeper_less, NULL);
+  clock_program (timer_rdtsc (), false);
+  thread_block ();
+  intr_set_level (old_level);
+}
+
+/* Wakes up the high-resolution sleepers whose deadlines are at
+   or before NOW.  Called from the timer interrupt. */
+static void
+hr_expire (uint64_t now) 
+{
+  struct wake_batch batch;
+
+  wake_batch_init (&batch);
+  while (!list_empty (&hr_sleepers))
+    {
+      struct hr_sleeper *first = list_entry (list_front (&hr_sleepers),
+                                             struct hr_sleeper, elem);
+      if (first->deadline > now)
+        break;
+
+      list_pop_front (&hr_sleepers);
+      wake_batch_add (&batch, first->thread);
+      hr_wakeups++;
+    }
+  wake_batch_finish (&batch, true);
+}
+
+/* Puts EVENT into the timing wheel slot for its expiration time,
+   relative to wheel_next.  Interrupts must be off. */
+static void
+wheel_insert (struct timer_event *event)
+{
+  int64_t expires = event->expires;
+  int64_t delay = expires - wheel_next;
+  int level;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (delay < 0)
+    {
+      /* Already expired: fire on the next tick processed. */
+      expires = wheel_next;
+      delay = 0;
+    }
+  else if (delay >= (int64_t) 1 << (WHEEL_BITS * WHEEL_LEVELS))
+    {
+      /* Beyond the span of the wheel: park in the farthest slot,
+         from which it will be cascaded again. */
+      delay = ((int64_t) 1 << (WHEEL_BITS * WHEEL_LEVELS)) - 1;
+      expires = wheel_next + delay;
+    }
+
+  for (level = 0; delay >= (int64_t) 1 << (WHEEL_BITS * (level + 1)); level++)
+    continue;
+  list_push_back (&wheel[level][(expires >> (WHEEL_BITS * level))
+                                & WHEEL_MASK],
+                  &event->elem);
+}
+
+/* Returns the first tick from wheel_next up to LIMIT at which
+   the timing wheel has work to do, that is, an event to fire or
+   a cascade that may produce one, or LIMIT if there is none
+   sooner.  Interrupts must be off. */
+static int64_t
+wheel_next_event (int64_t limit)
+{
+  int64_t t;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  for (t = wheel_next; t < limit; t++)
+    if ((t & WHEEL_MASK) == 0 || !list_empty (&wheel[0][t & WHEEL_MASK]))
+      return t;
+  return limit;
+}
+
+/* Processes timer tick wheel_next: cascades higher levels as
+   needed and fires the events due on this tick.  Interrupts must
+   be off. */
+static void
+wheel_advance (void)
+{
+  int64_t now = wheel_next;
+  struct list *due = &wheel[0][now & WHEEL_MASK];
+  struct list expired;
+  struct wake_batch batch;
+  int level;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  /* Cascade each level whose lower neighbor just wrapped. */
+  for (level = 1; level < WHEEL_LEVELS; level++)
+    {
+      struct list *slot;
+
+      if (((now >> (WHEEL_BITS * (level - 1))) & WHEEL_MASK) != 0)
+        break;
+      slot = &wheel[level][(now >> (WHEEL_BITS * level)) & WHEEL_MASK];
+      while (!list_empty (slot))
+        wheel_insert (list_entry (list_pop_front (slot),
+                                  struct timer_event, elem));
+    }
+
+  /* Take the whole batch due now off the wheel before running any
+     of it, so that event functions may safely re-arm. */
+  wheel_next = now + 1;
+  list_init (&expired);
+  if (!list_empty (due))
+    list_splice (list_end (&expired), list_begin (due), list_end (due));
+  wake_batch_init (&batch);
+  wheel_batch = &batch;
+  while (!list_empty (&expired))
+    {
+      struct timer_event *event = list_entry (list_pop_front (&expired),
+                                              struct timer_event, elem);
+      event->armed = false;
+      event->func (event->aux);
+    }
+  wheel_batch = NULL;
+  wake_batch_finish (&batch, true);
+}
+
 /* Returns true if LOOPS iterations waits for more than one timer
    tick, otherwise false. */
 static bool
@@ -310,6 +839,15 @@ real_time_sleep (int64_t num, int32_t denom)
          processes. */                
       timer_sleep (ticks); 
     }
+  else if (num <= 0)
+    return;
+  else if (tsc_hz != 0)
+    {
+      /* Block until a one-shot timer interrupt, for accurate
+         sub-tick timing without tying up the CPU. */
+      ASSERT (NSEC_PER_SEC % denom == 0);
+      hr_sleep (num * (NSEC_PER_SEC / denom));
+    }
   else 
     {
       /* Otherwise, use a busy-wait loop for more accurate
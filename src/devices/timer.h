@@ -1,26 +1,58 @@
 #ifndef DEVICES_TIMER_H
 #define DEVICES_TIMER_H
 
+#include <list.h>
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /* Number of timer interrupts per second. */
 #define TIMER_FREQ 100
 
+/* Stop the periodic tick while idle?
+   Controlled by kernel command-line option "-tickless". */
+extern bool timer_tickless;
+
+/* Fire timer events from the timer interrupt handler?
+   Controlled by kernel command-line option "-inline-timers". */
+extern bool timer_inline_events;
+
 void timer_init (void);
 void timer_calibrate (void);
 
 int64_t timer_ticks (void);
 int64_t timer_elapsed (int64_t);
+int64_t timer_now_ns (void);
+
+/* Returns the CPU's time stamp counter, which counts processor
+   clock cycles.  See [IA32-v2b] "RDTSC". */
+static inline uint64_t
+timer_rdtsc (void) 
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
 
-/////////////////////////////////////
-// prj1(wait) - sungmin oh - start //
-// define timer_wakeup function. it is implemented in /devices/timer.c
-void timer_wakeup(void);
-//bool less_wakeup_ticks(const struct list_elem*, const struct list_elem*, void*);
- 
-// prj1(wait) - sungmin oh - end //
-///////////////////////////////////
+/* A one-shot timer event.  Once armed, FUNC(AUX) is called with
+   interrupts off soon after the first timer tick at or after
+   EXPIRES, from a kernel worker thread (see threads/workqueue.h)
+   or, with -inline-timers, from the timer interrupt handler.
+   Either way FUNC must not sleep.  Events are kept in a
+   hierarchical timing wheel, so arming and cancelling are O(1). */
+typedef void timer_event_func (void *aux);
+struct timer_event
+  {
+    int64_t expires;                    /* Tick at which to fire. */
+    struct list_elem elem;              /* Timing wheel slot element. */
+    timer_event_func *func;             /* Function to call. */
+    void *aux;                          /* Auxiliary data for FUNC. */
+    bool armed;                         /* Waiting to fire? */
+  };
+
+void timer_event_init (struct timer_event *, timer_event_func *, void *aux);
+void timer_event_arm (struct timer_event *, int64_t expires);
+bool timer_event_cancel (struct timer_event *);
 
 /* Sleep and yield the CPU to other threads. */
 void timer_sleep (int64_t ticks);
@@ -33,6 +65,10 @@ void timer_mdelay (int64_t milliseconds);
 void timer_udelay (int64_t microseconds);
 void timer_ndelay (int64_t nanoseconds);
 
+/* Dynamic ticks, used by the idle thread. */
+void timer_idle_enter (void);
+void timer_idle_exit (void);
+
 void timer_print_stats (void);
 
 #endif /* devices/timer.h */
@@ -0,0 +1,196 @@
+#include "heap.h"
+#include "../debug.h"
+
+/* Our heap is a pairing heap: a tree in which every node is
+   greater than or equal to its children, with each node's
+   children kept in a doubly linked list of siblings.  Two heaps
+   are combined ("melded") by making the root with the smaller
+   value the first child of the other.  Removing the root melds
+   its children together in pairs from left to right, then melds
+   the pairs from right to left, which keeps the amortized cost
+   of every operation that removes an element at O(log n).
+
+   See M. L. Fredman, R. Sedgewick, D. D. Sleator, and
+   R. E. Tarjan, "The Pairing Heap: A New Form of Self-Adjusting
+   Heap", Algorithmica 1 (1986). */
+
+static struct heap_elem *meld (struct heap *,
+                               struct heap_elem *, struct heap_elem *);
+static struct heap_elem *merge_pairs (struct heap *, struct heap_elem *);
+static void cut (struct heap_elem *);
+
+/* Initializes HEAP as an empty heap ordered by LESS given
+   auxiliary data AUX. */
+void
+heap_init (struct heap *heap, heap_less_func *less, void *aux) 
+{
+  ASSERT (heap != NULL);
+  ASSERT (less != NULL);
+
+  heap->root = NULL;
+  heap->less = less;
+  heap->aux = aux;
+}
+
+/* Returns true if HEAP is empty, false otherwise. */
+bool
+heap_empty (const struct heap *heap) 
+{
+  return heap->root == NULL;
+}
+
+/* Inserts ELEM into HEAP. */
+void
+heap_insert (struct heap *heap, struct heap_elem *elem) 
+{
+  ASSERT (heap != NULL);
+  ASSERT (elem != NULL);
+
+  elem->child = elem->next = elem->prev = NULL;
+  heap->root = meld (heap, heap->root, elem);
+}
+
+/* Returns the maximum element in HEAP.  If more than one element
+   is maximum, returns an arbitrary one of them.  Undefined
+   behavior if HEAP is empty. */
+struct heap_elem *
+heap_max (const struct heap *heap) 
+{
+  ASSERT (!heap_empty (heap));
+  return heap->root;
+}
+
+/* Removes the maximum element from HEAP and returns it.
+   Undefined behavior if HEAP is empty. */
+struct heap_elem *
+heap_pop_max (struct heap *heap) 
+{
+  struct heap_elem *max = heap_max (heap);
+
+  heap->root = merge_pairs (heap, max->child);
+  max->child = NULL;
+  return max;
+}
+
+/* Removes ELEM, which must be in HEAP, from HEAP. */
+void
+heap_remove (struct heap *heap, struct heap_elem *elem) 
+{
+  ASSERT (heap != NULL);
+  ASSERT (elem != NULL);
+
+  if (elem == heap->root)
+    heap_pop_max (heap);
+  else
+    {
+      cut (elem);
+      heap->root = meld (heap, heap->root, merge_pairs (heap, elem->child));
+      elem->child = NULL;
+    }
+}
+
+/* Restores HEAP's order after the value of ELEM, which must be
+   in HEAP, has increased or stayed the same. */
+void
+heap_increase (struct heap *heap, struct heap_elem *elem) 
+{
+  ASSERT (heap != NULL);
+  ASSERT (elem != NULL);
+
+  if (elem != heap->root)
+    {
+      /* ELEM is still greater than or equal to its children, so
+         its whole subtree can move up. */
+      cut (elem);
+      heap->root = meld (heap, heap->root, elem);
+    }
+}
+
+/* Restores HEAP's order after the value of ELEM, which must be
+   in HEAP, has changed in either direction. */
+void
+heap_update (struct heap *heap, struct heap_elem *elem) 
+{
+  heap_remove (heap, elem);
+  heap_insert (heap, elem);
+}
+
+/* Melds heaps rooted at A and B, either of which may be null,
+   and returns the root of the result.  A and B must not have
+   siblings. */
+static struct heap_elem *
+meld (struct heap *heap, struct heap_elem *a, struct heap_elem *b) 
+{
+  if (a == NULL)
+    return b;
+  if (b == NULL)
+    return a;
+  if (heap->less (a, b, heap->aux)) 
+    {
+      struct heap_elem *t = a;
+      a = b;
+      b = t;
+    }
+
+  /* Make B the first child of A. */
+  b->prev = a;
+  b->next = a->child;
+  if (a->child != NULL)
+    a->child->prev = b;
+  a->child = b;
+  return a;
+}
+
+/* Melds FIRST and its following siblings into a single heap
+   and returns its root, which may be null. */
+static struct heap_elem *
+merge_pairs (struct heap *heap, struct heap_elem *first) 
+{
+  struct heap_elem *pairs = NULL;       /* Melded pairs, most recent
+                                           first, linked by `next'. */
+  struct heap_elem *root = NULL;
+
+  /* Meld siblings in pairs, left to right. */
+  while (first != NULL) 
+    {
+      struct heap_elem *a = first;
+      struct heap_elem *b = first->next;
+
+      first = b != NULL ? b->next : NULL;
+      a->next = a->prev = NULL;
+      if (b != NULL) 
+        {
+          b->next = b->prev = NULL;
+          a = meld (heap, a, b);
+        }
+      a->next = pairs;
+      pairs = a;
+    }
+
+  /* Meld the pairs, right to left. */
+  while (pairs != NULL) 
+    {
+      struct heap_elem *next = pairs->next;
+      pairs->next = NULL;
+      root = meld (heap, root, pairs);
+      pairs = next;
+    }
+
+  return root;
+}
+
+/* Detaches ELEM, which must not be a root, and its subtree from
+   its parent. */
+static void
+cut (struct heap_elem *elem) 
+{
+  ASSERT (elem->prev != NULL);
+
+  if (elem->prev->child == elem)
+    elem->prev->child = elem->next;
+  else
+    elem->prev->next = elem->next;
+  if (elem->next != NULL)
+    elem->next->prev = elem->prev;
+  elem->next = elem->prev = NULL;
+}
@@ -0,0 +1,109 @@
+#include "pqueue.h"
+#include "../debug.h"
+
+/* A priority queue is a heap ordered first by priority, then by
+   order of arrival.  Each element is stamped with a sequence
+   number when it is pushed.  Sequence numbers are compared by
+   their difference, so wraparound is harmless as long as fewer
+   than 2**31 elements arrive while any one element waits. */
+
+/* Returns true if element A ranks below element B: lower
+   priority, or equal priority and later arrival. */
+static bool
+pqueue_less (const struct heap_elem *a_, const struct heap_elem *b_,
+             void *aux UNUSED) 
+{
+  const struct pqueue_elem *a = heap_entry (a_, struct pqueue_elem,
+                                            heap_elem);
+  const struct pqueue_elem *b = heap_entry (b_, struct pqueue_elem,
+                                            heap_elem);
+
+  if (a->priority != b->priority)
+    return a->priority < b->priority;
+  return (int) (a->seq - b->seq) > 0;
+}
+
+/* Initializes PQ as an empty priority queue. */
+void
+pqueue_init (struct pqueue *pq) 
+{
+  ASSERT (pq != NULL);
+
+  heap_init (&pq->heap, pqueue_less, NULL);
+  pq->size = 0;
+  pq->next_seq = 0;
+}
+
+/* Returns true if PQ is empty, false otherwise. */
+bool
+pqueue_empty (const struct pqueue *pq) 
+{
+  return pq->size == 0;
+}
+
+/* Returns the number of elements in PQ. */
+size_t
+pqueue_size (const struct pqueue *pq) 
+{
+  return pq->size;
+}
+
+/* Adds ELEM to PQ with the given PRIORITY, behind any elements
+   already in PQ with the same priority. */
+void
+pqueue_push (struct pqueue *pq, struct pqueue_elem *elem, int priority) 
+{
+  ASSERT (pq != NULL);
+  ASSERT (elem != NULL);
+
+  elem->priority = priority;
+  elem->seq = pq->next_seq++;
+  heap_insert (&pq->heap, &elem->heap_elem);
+  pq->size++;
+}
+
+/* Returns the element at the front of PQ: the one with the
+   highest priority that has waited longest.  Undefined behavior
+   if PQ is empty. */
+struct pqueue_elem *
+pqueue_front (const struct pqueue *pq) 
+{
+  return heap_entry (heap_max (&pq->heap), struct pqueue_elem, heap_elem);
+}
+
+/* Removes the front element of PQ and returns it.  Undefined
+   behavior if PQ is empty. */
+struct pqueue_elem *
+pqueue_pop (struct pqueue *pq) 
+{
+  ASSERT (!pqueue_empty (pq));
+
+  pq->size--;
+  return heap_entry (heap_pop_max (&pq->heap), struct pqueue_elem,
+                     heap_elem);
+}
+
+/* Removes ELEM, which must be in PQ, from PQ. */
+void
+pqueue_remove (struct pqueue *pq, struct pqueue_elem *elem) 
+{
+  ASSERT (!pqueue_empty (pq));
+
+  heap_remove (&pq->heap, &elem->heap_elem);
+  pq->size--;
+}
+
+/* Changes the priority of ELEM, which must be in PQ, to
+   PRIORITY. */
+void
+pqueue_set_priority (struct pqueue *pq, struct pqueue_elem *elem,
+                     int priority) 
+{
+  int old_priority = elem->priority;
+
+  elem->priority = priority;
+  if (priority > old_priority)
+    heap_increase (&pq->heap, &elem->heap_elem);
+  else if (priority < old_priority)
+    heap_update (&pq->heap, &elem->heap_elem);
+}
@@ -0,0 +1,61 @@
+#ifndef __LIB_KERNEL_PQUEUE_H
+#define __LIB_KERNEL_PQUEUE_H
+
+/* Priority queue with first-in, first-out order among elements
+   of equal priority, suitable for queues of waiting threads.
+
+   Like a list, a priority queue does not require dynamically
+   allocated memory: each potential element embeds a `struct
+   pqueue_elem' member, and pqueue_entry() converts it back to
+   the enclosing structure.  Unlike a heap, the queue stores each
+   element's priority itself, so no comparison function is
+   needed.
+
+   pqueue_push() and pqueue_front() take constant time.
+   pqueue_pop(), pqueue_remove(), and pqueue_set_priority() take
+   O(log n) amortized time.  An element whose priority changes
+   through pqueue_set_priority() keeps its place in line among
+   elements of its new priority, as if it had always had that
+   priority. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "heap.h"
+
+/* Priority queue element. */
+struct pqueue_elem 
+  {
+    struct heap_elem heap_elem; /* Element in pqueue's heap. */
+    int priority;               /* Priority. */
+    unsigned seq;               /* Order of arrival. */
+  };
+
+/* Priority queue. */
+struct pqueue 
+  {
+    struct heap heap;           /* Elements, by priority and seq. */
+    size_t size;                /* Number of elements. */
+    unsigned next_seq;          /* Next arrival's seq. */
+  };
+
+/* Converts pointer to priority queue element PQUEUE_ELEM into a
+   pointer to the structure that PQUEUE_ELEM is embedded inside.
+   Supply the name of the outer structure STRUCT and the member
+   name MEMBER of the priority queue element. */
+#define pqueue_entry(PQUEUE_ELEM, STRUCT, MEMBER)               \
+        ((STRUCT *) ((uint8_t *) &(PQUEUE_ELEM)->priority       \
+                     - offsetof (STRUCT, MEMBER.priority)))
+
+void pqueue_init (struct pqueue *);
+bool pqueue_empty (const struct pqueue *);
+size_t pqueue_size (const struct pqueue *);
+
+void pqueue_push (struct pqueue *, struct pqueue_elem *, int priority);
+struct pqueue_elem *pqueue_front (const struct pqueue *);
+struct pqueue_elem *pqueue_pop (struct pqueue *);
+void pqueue_remove (struct pqueue *, struct pqueue_elem *);
+void pqueue_set_priority (struct pqueue *, struct pqueue_elem *,
+                          int priority);
+
+#endif /* lib/kernel/pqueue.h */
@@ -0,0 +1,26 @@
+#ifndef __LIB_SCHED_STATS_H
+#define __LIB_SCHED_STATS_H
+
+/* Scheduling statistics for one thread, as kept by the kernel
+   and returned to user programs by the sched_stats() system
+   call. */
+
+/* Number of buckets in the run-queue wait histogram.  Bucket B
+   counts waits of less than 2**(B+1) microseconds that did not
+   fit in a lower bucket; the last bucket counts all longer
+   waits. */
+#define SCHED_WAIT_BUCKETS 20
+
+struct sched_stats
+  {
+    int tid;                            /* Thread identifier. */
+    char name[16];                      /* Thread name. */
+    unsigned user_ticks;                /* Ticks running user code. */
+    unsigned kernel_ticks;              /* Ticks running in the kernel. */
+    unsigned scheduled;                 /* # of times switched to. */
+    unsigned voluntary_switches;        /* # of times it blocked. */
+    unsigned involuntary_switches;      /* # of times it was preempted. */
+    unsigned wait_hist[SCHED_WAIT_BUCKETS]; /* Run-queue waits. */
+  };
+
+#endif /* lib/sched-stats.h */
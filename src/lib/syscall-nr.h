@@ -28,7 +28,15 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Extensions. */
+    SYS_SCHED_STATS,            /* Obtain a thread's scheduling statistics. */
+    SYS_THREAD_CREATE,          /* Start another thread in this process. */
+    SYS_THREAD_EXIT,            /* Terminate this thread. */
+    SYS_THREAD_JOIN,            /* Wait for a thread to die. */
+    SYS_FUTEX_WAIT,             /* Sleep while a futex has a value. */
+    SYS_FUTEX_WAKE              /* Wake threads sleeping on a futex. */
   };
 
 #endif /* lib/syscall-nr.h */
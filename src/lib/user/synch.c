@@ -0,0 +1,130 @@
+#include <synch.h>
+#include <debug.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <syscall.h>
+
+/* Atomically stores NEW in *P and returns the old value. */
+static inline int
+atomic_xchg (int *p, int new) 
+{
+  asm volatile ("xchgl %0, %1" : "+r" (new), "+m" (*p) : : "memory");
+  return new;
+}
+
+/* Atomically stores NEW in *P if it equals OLD.  Returns the
+   value *P had before. */
+static inline int
+atomic_cmpxchg (int *p, int old, int new) 
+{
+  int prev;
+  asm volatile ("lock cmpxchgl %2, %1"
+                : "=a" (prev), "+m" (*p) : "r" (new), "0" (old) : "memory");
+  return prev;
+}
+
+/* Atomically increments *P. */
+static inline void
+atomic_inc (int *p) 
+{
+  asm volatile ("lock incl %0" : "+m" (*p) : : "memory");
+}
+
+/* Initializes M as unlocked. */
+void
+mutex_init (struct mutex *m) 
+{
+  m->state = 0;
+}
+
+/* Acquires M, sleeping until it is available if necessary.
+
+   If M is unlocked, a single atomic instruction locks it.
+   Otherwise M is marked contended, which tells the holder to
+   wake a sleeper when it unlocks, and the caller sleeps for as
+   long as it stays locked. */
+void
+mutex_lock (struct mutex *m) 
+{
+  int c = atomic_cmpxchg (&m->state, 0, 1);
+
+  if (c != 0) 
+    {
+      if (c != 2)
+        c = atomic_xchg (&m->state, 2);
+      while (c != 0) 
+        {
+          futex_wait (&m->state, 2);
+          c = atomic_xchg (&m->state, 2);
+        }
+    }
+}
+
+/* Acquires M if it is unlocked, without sleeping.  Returns true
+   if successful. */
+bool
+mutex_trylock (struct mutex *m) 
+{
+  return atomic_cmpxchg (&m->state, 0, 1) == 0;
+}
+
+/* Releases M, which the caller must hold, and wakes up a thread
+   waiting for it if there may be one. */
+void
+mutex_unlock (struct mutex *m) 
+{
+  if (atomic_xchg (&m->state, 0) == 2)
+    futex_wake (&m->state, 1);
+}
+
+/* Initializes CV as a condition variable with no waiters. */
+void
+condvar_init (struct condvar *cv) 
+{
+  cv->seq = 0;
+  cv->waiters = 0;
+}
+
+/* Atomically releases M and waits for CV to be signaled, then
+   reacquires M.  M must be held.  As with any condition
+   variable, the caller should recheck its condition upon
+   return. */
+void
+condvar_wait (struct condvar *cv, struct mutex *m) 
+{
+  int seq = cv->seq;
+
+  cv->waiters++;
+  mutex_unlock (m);
+
+  /* If CV is signaled after we unlock M, SEQ is out of date and
+     futex_wait() returns at once. */
+  futex_wait (&cv->seq, seq);
+
+  /* Other threads may be waiting for M, so lock it as contended. */
+  while (atomic_xchg (&m->state, 2) != 0)
+    futex_wait (&m->state, 2);
+  cv->waiters--;
+}
+
+/* Wakes up one thread waiting on CV, if any.  M must be held. */
+void
+condvar_signal (struct condvar *cv, struct mutex *m UNUSED) 
+{
+  if (cv->waiters > 0) 
+    {
+      atomic_inc (&cv->seq);
+      futex_wake (&cv->seq, 1);
+    }
+}
+
+/* Wakes up all threads waiting on CV.  M must be held. */
+void
+condvar_broadcast (struct condvar *cv, struct mutex *m UNUSED) 
+{
+  if (cv->waiters > 0) 
+    {
+      atomic_inc (&cv->seq);
+      futex_wake (&cv->seq, INT_MAX);
+    }
+}
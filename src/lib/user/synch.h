@@ -0,0 +1,38 @@
+#ifndef __LIB_USER_SYNCH_H
+#define __LIB_USER_SYNCH_H
+
+#include <stdbool.h>
+
+/* Mutexes and condition variables for the threads of a user
+   process, built on futexes.  Neither locking nor unlocking an
+   uncontended mutex enters the kernel, and neither does
+   signaling a condition variable that no thread is waiting on. */
+
+/* Mutex. */
+struct mutex 
+  {
+    int state;          /* 0=unlocked, 1=locked, 2=locked, contended. */
+  };
+
+#define MUTEX_INITIALIZER { 0 }
+
+void mutex_init (struct mutex *);
+void mutex_lock (struct mutex *);
+bool mutex_trylock (struct mutex *);
+void mutex_unlock (struct mutex *);
+
+/* Condition variable. */
+struct condvar 
+  {
+    int seq;            /* Incremented by every signal. */
+    int waiters;        /* # of waiting threads, under the mutex. */
+  };
+
+#define CONDVAR_INITIALIZER { 0, 0 }
+
+void condvar_init (struct condvar *);
+void condvar_wait (struct condvar *, struct mutex *);
+void condvar_signal (struct condvar *, struct mutex *);
+void condvar_broadcast (struct condvar *, struct mutex *);
+
+#endif /* lib/user/synch.h */
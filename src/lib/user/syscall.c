@@ -182,3 +182,49 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+bool
+sched_stats (pid_t pid, struct sched_stats *stats) 
+{
+  return syscall2 (SYS_SCHED_STATS, pid, stats);
+}
+
+/* Entry point of threads created by thread_create(): runs
+   FUNC(AUX), then exits the thread. */
+static void
+thread_start (void (*func) (void *aux), void *aux) 
+{
+  func (aux);
+  thread_exit (0);
+}
+
+tid_t
+thread_create (void (*func) (void *aux), void *aux) 
+{
+  return syscall3 (SYS_THREAD_CREATE, thread_start, func, aux);
+}
+
+void
+thread_exit (int status) 
+{
+  syscall1 (SYS_THREAD_EXIT, status);
+  NOT_REACHED ();
+}
+
+int
+thread_join (tid_t tid) 
+{
+  return syscall1 (SYS_THREAD_JOIN, tid);
+}
+
+int
+futex_wait (int *addr, int val) 
+{
+  return syscall2 (SYS_FUTEX_WAIT, addr, val);
+}
+
+int
+futex_wake (int *addr, int cnt) 
+{
+  return syscall2 (SYS_FUTEX_WAKE, addr, cnt);
+}
@@ -3,11 +3,16 @@
 
 #include <stdbool.h>
 #include <debug.h>
+#include <sched-stats.h>
 
 /* Process identifier. */
 typedef int pid_t;
 #define PID_ERROR ((pid_t) -1)
 
+/* Thread identifier. */
+typedef int tid_t;
+#define TID_ERROR ((tid_t) -1)
+
 /* Map region identifier. */
 typedef int mapid_t;
 #define MAP_FAILED ((mapid_t) -1)
@@ -45,4 +50,22 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Extensions. */
+bool sched_stats (pid_t, struct sched_stats *);
+
+/* Threads within a process.  A process ends when its main
+   thread exits; exit() in any other thread ends only that
+   thread, like thread_exit(). */
+tid_t thread_create (void (*func) (void *aux), void *aux);
+void thread_exit (int status) NO_RETURN;
+int thread_join (tid_t);
+
+/* Futexes, for building synchronization primitives; see
+   <synch.h>.  futex_wait() sleeps only if *ADDR == VAL, and
+   returns 0 when woken or -1 if it did not sleep.  futex_wake()
+   wakes up to CNT sleepers, highest priority first, and returns
+   the number woken. */
+int futex_wait (int *addr, int val);
+int futex_wake (int *addr, int cnt);
+
 #endif /* lib/user/syscall.h */
@@ -0,0 +1,75 @@
+/* Checks sleeps shorter than a timer tick.
+
+   Sleeps a number of times for each of several sub-tick
+   durations with timer_usleep(), timing each sleep with
+   timer_now_ns().  No sleep may end early, and none may
+   overshoot by more than a timer tick, which is what rounding
+   the sleep up to whole ticks would cost.
+
+   Meanwhile a lower-priority thread counts in a loop.  It can
+   only run while the main thread is blocked, so if the sleeps
+   busy-wait instead of blocking, it never gets to count. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define ITERATIONS 20
+
+static thread_func spinner;
+static volatile bool done;
+static volatile int64_t spins;
+static struct semaphore spinner_done;
+
+void
+test_alarm_hires (void) 
+{
+  static const int64_t durations[] = {10, 50, 100, 500, 1000, 5000};
+  size_t i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&spinner_done, 0);
+  thread_create ("spinner", PRI_DEFAULT - 1, spinner, NULL);
+
+  for (i = 0; i < sizeof durations / sizeof *durations; i++) 
+    {
+      int64_t us = durations[i];
+      int j;
+
+      for (j = 0; j < ITERATIONS; j++) 
+        {
+          int64_t start = timer_now_ns ();
+          int64_t late;
+
+          timer_usleep (us);
+          late = timer_now_ns () - start - us * 1000;
+          if (late < 0)
+            fail ("%"PRId64" us sleep ended %"PRId64" ns early", us, -late);
+          if (late > 1000000000 / TIMER_FREQ)
+            fail ("%"PRId64" us sleep ended %"PRId64" ns late", us, late);
+        }
+      msg ("%"PRId64" us sleeps ended on time", us);
+    }
+
+  if (spins == 0)
+    fail ("lower-priority thread never ran while we slept");
+  msg ("lower-priority thread ran while we slept");
+
+  done = true;
+  sema_down (&spinner_done);
+  pass ();
+}
+
+static void
+spinner (void *aux UNUSED) 
+{
+  while (!done)
+    spins++;
+  sema_up (&spinner_done);
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(alarm-hires) begin
+(alarm-hires) 10 us sleeps ended on time
+(alarm-hires) 50 us sleeps ended on time
+(alarm-hires) 100 us sleeps ended on time
+(alarm-hires) 500 us sleeps ended on time
+(alarm-hires) 1000 us sleeps ended on time
+(alarm-hires) 5000 us sleeps ended on time
+(alarm-hires) lower-priority thread ran while we slept
+(alarm-hires) PASS
+(alarm-hires) end
+EOF
+pass;
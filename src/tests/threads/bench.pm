@@ -0,0 +1,28 @@
+# -*- perl -*-
+use strict;
+use warnings;
+
+# Checks the output of a benchmark that checks its own results
+# and prints figures that vary from run to run: the run must pass
+# the common checks, and every line of its core output must be
+# one of its own messages, ending with PASS.
+sub check_bench {
+    our ($test);
+    my ($name) = $test;
+    $name =~ s%.*/%%;
+
+    my (@output) = read_text_file ("$test.output");
+    common_checks ("run", @output);
+    @output = get_core_output ("run", @output);
+
+    fail "missing \"($name) begin\" in output\n"
+      if !@output || $output[0] ne "($name) begin";
+    fail "missing \"($name) PASS\" in output\n"
+      if !grep ($_ eq "($name) PASS", @output);
+    foreach (@output) {
+	fail "unexpected line in output: $_\n" if !/^\(\Q$name\E\) /;
+    }
+    pass;
+}
+
+1;
@@ -0,0 +1,102 @@
+/* Checks the earliest-deadline-first scheduling class.  A
+   real-time thread that needs 2 ticks of every 10, within 5
+   ticks of the start of each period, must meet every deadline
+   even though several threads of higher priority than its own
+   keep the CPU saturated.  Also checks that admission control
+   rejects invalid reservations and ones that would overcommit
+   the CPU. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define SPINNER_CNT 3
+#define PERIOD_CNT 20
+
+static thread_func spinner, realtime;
+
+static struct semaphore admitted, done, spinners_done;
+static volatile bool stop;
+static volatile unsigned spins;
+static int missed;
+
+void
+test_edf_deadline (void) 
+{
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&admitted, 0);
+  sema_init (&done, 0);
+  sema_init (&spinners_done, 0);
+  thread_set_priority (PRI_DEFAULT + 1);
+
+  if (thread_set_realtime (5, 4, 10))
+    fail ("runtime longer than deadline was admitted");
+  if (thread_set_realtime (10, 10, 10))
+    fail ("reservation of the whole CPU was admitted");
+
+  thread_create ("realtime", PRI_MAX, realtime, NULL);
+  sema_down (&admitted);
+  msg ("real-time thread admitted");
+  if (thread_set_realtime (6, 10, 10))
+    fail ("reservation overcommitting the CPU was admitted");
+  msg ("overcommitting reservation rejected");
+
+  for (i = 0; i < SPINNER_CNT; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "spinner %d", i);
+      thread_create (name, PRI_DEFAULT, spinner, NULL);
+    }
+
+  sema_down (&done);
+  stop = true;
+  for (i = 0; i < SPINNER_CNT; i++)
+    sema_down (&spinners_done);
+
+  if (spins == 0)
+    fail ("background threads never ran");
+  msg ("%d periods, %d deadlines missed", PERIOD_CNT, missed);
+}
+
+/* Keeps the CPU busy until the test is over. */
+static void
+spinner (void *aux UNUSED) 
+{
+  while (!stop)
+    spins++;
+  sema_up (&spinners_done);
+}
+
+/* Reserves 2 ticks in every 10 with a deadline of 5, and in each
+   period busy-waits for the next timer tick. */
+static void
+realtime (void *aux UNUSED) 
+{
+  int i;
+
+  if (!thread_set_realtime (2, 5, 10))
+    fail ("real-time thread was not admitted");
+
+  /* From now on only the reservation lets us run ahead of the
+     spinners. */
+  thread_set_priority (PRI_MIN);
+  sema_up (&admitted);
+
+  for (i = 0; i < PERIOD_CNT; i++) 
+    {
+      int64_t start = timer_ticks ();
+      while (timer_ticks () == start)
+        continue;
+      if (!thread_wait_period ())
+        missed++;
+    }
+  thread_set_realtime (0, 0, 0);
+  sema_up (&done);
+}
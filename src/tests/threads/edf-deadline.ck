@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(edf-deadline) begin
+(edf-deadline) real-time thread admitted
+(edf-deadline) overcommitting reservation rejected
+(edf-deadline) 20 periods, 0 deadlines missed
+(edf-deadline) end
+EOF
+pass;
@@ -0,0 +1,132 @@
+/* Measures how well malloc() packs a mix of request sizes into
+   pages.  Keeps a few hundred blocks of random sizes live, most
+   of them small like the strings and records the kernel
+   allocates, while freeing, reallocating, and replacing them at
+   random.  Reports the bytes requested by the live blocks
+   against the bytes in the pages malloc() holds for them, along
+   with how many realloc() calls kept their block in place.
+   Also checks that no block's contents are lost. */
+
+#include <random.h>
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/malloc.h"
+#include "threads/vaddr.h"
+
+#define SLOT_CNT 512            /* Blocks live at a time, at most. */
+#define ITERATIONS 20000        /* Operations. */
+
+static uint8_t *blocks[SLOT_CNT];
+static size_t sizes[SLOT_CNT];
+
+/* Returns a random request size: mostly short strings and small
+   records, some mid-sized records, and a few page-sized
+   buffers. */
+static size_t
+random_size (void) 
+{
+  unsigned kind = random_ulong () % 16;
+
+  if (kind < 10)
+    return 1 + random_ulong () % 64;
+  else if (kind < 15)
+    return 65 + random_ulong () % 700;
+  else
+    return 1024 + random_ulong () % (2 * PGSIZE);
+}
+
+/* Checks that the block in SLOT still holds its fill byte. */
+static void
+check_slot (int slot) 
+{
+  if (blocks[slot][0] != (uint8_t) slot
+      || blocks[slot][sizes[slot] - 1] != (uint8_t) slot)
+    fail ("block in slot %d was overwritten", slot);
+}
+
+void
+test_malloc_frag (void) 
+{
+  size_t base_pages = malloc_page_cnt ();
+  size_t requested = 0, peak_requested = 0, peak_pages = 0;
+  unsigned realloc_cnt = 0, in_place_cnt = 0;
+  int i;
+
+  random_init (0);
+  for (i = 0; i < ITERATIONS; i++) 
+    {
+      int slot = random_ulong () % SLOT_CNT;
+      size_t pages;
+
+      if (blocks[slot] == NULL) 
+        {
+          sizes[slot] = random_size ();
+          blocks[slot] = malloc (sizes[slot]);
+          if (blocks[slot] == NULL)
+            fail ("malloc(%zu) failed", sizes[slot]);
+          memset (blocks[slot], slot, sizes[slot]);
+          requested += sizes[slot];
+        }
+      else if (random_ulong () % 2 == 0) 
+        {
+          /* Grow or shrink by up to 25%, as a growing buffer or a
+             trimmed string would. */
+          size_t old_size = sizes[slot];
+          size_t delta = old_size / 4 + 1;
+          size_t new_size = random_ulong () % 2 == 0
+                            ? old_size + random_ulong () % delta
+                            : old_size - random_ulong () % delta;
+          uint8_t *p;
+
+          check_slot (slot);
+          if (new_size == 0)
+            new_size = 1;
+          p = realloc (blocks[slot], new_size);
+          if (p == NULL)
+            fail ("realloc(%zu) failed", new_size);
+          realloc_cnt++;
+          if (p == blocks[slot])
+            in_place_cnt++;
+          if (p[0] != (uint8_t) slot
+              || p[(new_size < old_size ? new_size : old_size) - 1]
+                 != (uint8_t) slot)
+            fail ("realloc lost the contents of slot %d", slot);
+          memset (p, slot, new_size);
+          blocks[slot] = p;
+          sizes[slot] = new_size;
+          requested = requested - old_size + new_size;
+        }
+      else 
+        {
+          check_slot (slot);
+          free (blocks[slot]);
+          blocks[slot] = NULL;
+          requested -= sizes[slot];
+        }
+
+      pages = malloc_page_cnt () - base_pages;
+      if (requested > peak_requested) 
+        {
+          peak_requested = requested;
+          peak_pages = pages;
+        }
+    }
+
+  msg ("at peak, %zu bytes requested in %zu pages (%zu bytes), "
+       "%zu%% used", peak_requested, peak_pages, peak_pages * PGSIZE,
+       peak_pages > 0 ? peak_requested * 100 / (peak_pages * PGSIZE) : 0);
+  msg ("at the end, %zu bytes requested in %zu pages",
+       requested, malloc_page_cnt () - base_pages);
+  msg ("%u of %u reallocs kept their block in place",
+       in_place_cnt, realloc_cnt);
+
+  for (i = 0; i < SLOT_CNT; i++)
+    if (blocks[i] != NULL) 
+      {
+        check_slot (i);
+        free (blocks[i]);
+        blocks[i] = NULL;
+      }
+  pass ();
+}
@@ -0,0 +1,103 @@
+/* Stresses the page allocator with a long run of random
+   single-page and multipage allocations and frees of user pages,
+   which are otherwise unused when the kernel runs only kernel
+   threads.  Reports the average cost of each operation,
+   and the largest contiguous run of free pages in the middle of
+   the churn and once everything has been freed again, which must
+   be at least as large as before the churn began.  The idle
+   thread's zeroed-page cache is kept from growing meanwhile, so
+   that it cannot split free blocks behind the test's back. */
+
+#include <inttypes.h>
+#include <random.h>
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+#define SLOT_CNT 256            /* Allocations live at a time, at most. */
+#define ITERATIONS 20000        /* Allocations or frees. */
+#define MAX_RUN 16              /* Largest multipage request. */
+
+static uint8_t *pages[SLOT_CNT];
+static size_t page_cnts[SLOT_CNT];
+
+void
+test_palloc_bench (void) 
+{
+  size_t watermark = palloc_zero_watermark;
+  size_t initial;
+  uint64_t single_cycles = 0, multi_cycles = 0, free_cycles = 0;
+  unsigned single_cnt = 0, multi_cnt = 0, free_cnt = 0, fail_cnt = 0;
+  int i;
+
+  palloc_zero_watermark = 0;
+  initial = palloc_largest_free (PAL_USER);
+  random_init (0);
+  for (i = 0; i < ITERATIONS; i++) 
+    {
+      int slot = random_ulong () % SLOT_CNT;
+      uint64_t start;
+
+      if (pages[slot] == NULL) 
+        {
+          size_t cnt = random_ulong () % 4 == 0
+                       ? 2 + random_ulong () % (MAX_RUN - 1) : 1;
+
+          start = timer_rdtsc ();
+          pages[slot] = palloc_get_multiple (PAL_USER, cnt);
+          if (cnt == 1) 
+            {
+              single_cycles += timer_rdtsc () - start;
+              single_cnt++;
+            }
+          else 
+            {
+              multi_cycles += timer_rdtsc () - start;
+              multi_cnt++;
+            }
+          if (pages[slot] == NULL) 
+            {
+              fail_cnt++;
+              continue;
+            }
+          page_cnts[slot] = cnt;
+          memset (pages[slot], slot, cnt * PGSIZE);
+        }
+      else 
+        {
+          size_t ofs;
+
+          for (ofs = 0; ofs < page_cnts[slot] * PGSIZE; ofs += PGSIZE / 4)
+            if (pages[slot][ofs] != (uint8_t) slot)
+              fail ("pages in slot %d were overwritten", slot);
+          start = timer_rdtsc ();
+          palloc_free_multiple (pages[slot], page_cnts[slot]);
+          free_cycles += timer_rdtsc () - start;
+          free_cnt++;
+          pages[slot] = NULL;
+        }
+    }
+
+  msg ("%u single-page allocations, %"PRIu64" cycles each",
+       single_cnt, single_cycles / (single_cnt ? single_cnt : 1));
+  msg ("%u multipage allocations, %"PRIu64" cycles each",
+       multi_cnt, multi_cycles / (multi_cnt ? multi_cnt : 1));
+  msg ("%u frees, %"PRIu64" cycles each",
+       free_cnt, free_cycles / (free_cnt ? free_cnt : 1));
+  msg ("%u failed allocations", fail_cnt);
+  msg ("largest free run after churn: %zu pages", 
+       palloc_largest_free (PAL_USER));
+
+  for (i = 0; i < SLOT_CNT; i++)
+    if (pages[i] != NULL)
+      palloc_free_multiple (pages[i], page_cnts[i]);
+  msg ("largest free run at the end: %zu pages, at the start: %zu pages",
+       palloc_largest_free (PAL_USER), initial);
+  if (palloc_largest_free (PAL_USER) < initial)
+    fail ("freed pages were not merged back together");
+  palloc_zero_watermark = watermark;
+  pass ();
+}
@@ -0,0 +1,75 @@
+/* Checks that kernel and user pages come from one pool, that the
+   kernel may borrow from beyond its share, and that user pages,
+   which nothing can reclaim, may not.  Allocates user pages until
+   the allocator refuses, which must be no later than the user
+   share, and checks that the kernel can still get a page then.
+   Does the same the other way around. */
+
+#include "tests/threads/tests.h"
+#include "threads/palloc.h"
+
+/* Allocates pages with FLAGS until the allocator refuses,
+   linking them together through their first words, and returns
+   the first page, or a null pointer if there was none.  Stores
+   the number of pages in *CNT. */
+static void **
+grab_all (enum palloc_flags flags, size_t *cnt) 
+{
+  void **head = NULL;
+  void **page;
+
+  *cnt = 0;
+  while ((page = palloc_get_page (flags)) != NULL) 
+    {
+      *page = head;
+      head = page;
+      ++*cnt;
+    }
+  return head;
+}
+
+/* Frees the pages linked from HEAD. */
+static void
+release_all (void **head) 
+{
+  while (head != NULL) 
+    {
+      void **next = *head;
+      palloc_free_page (head);
+      head = next;
+    }
+}
+
+/* Grabs every page that the class selected by FLAGS can get,
+   checks that the class selected by OTHER can still get one,
+   and frees them all.  Returns the number of pages grabbed. */
+static size_t
+borrow (enum palloc_flags flags, enum palloc_flags other) 
+{
+  void **head;
+  void *page;
+  size_t cnt;
+
+  head = grab_all (flags, &cnt);
+  page = palloc_get_page (other);
+  if (page == NULL)
+    fail ("%s pages left nothing for %s pages",
+          flags & PAL_USER ? "user" : "kernel",
+          other & PAL_USER ? "user" : "kernel");
+  palloc_free_page (page);
+  release_all (head);
+  return cnt;
+}
+
+void
+test_palloc_borrow (void) 
+{
+  if (borrow (PAL_USER, 0) > palloc_share (PAL_USER))
+    fail ("user pages borrowed from the kernel's share");
+  msg ("user pages held to their share");
+  msg ("kernel page still available with user pages exhausted");
+
+  borrow (0, PAL_USER);
+  msg ("user page still available with kernel pages exhausted");
+  pass ();
+}
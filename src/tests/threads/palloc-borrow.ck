@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(palloc-borrow) begin
+(palloc-borrow) user pages held to their share
+(palloc-borrow) kernel page still available with user pages exhausted
+(palloc-borrow) user page still available with kernel pages exhausted
+(palloc-borrow) PASS
+(palloc-borrow) end
+EOF
+pass;
@@ -0,0 +1,69 @@
+/* Checks that PAL_ZERO pages handed out from the idle thread's
+   cache of zeroed pages really are zero, even though the pages
+   were dirtied before they were freed, and that pages cleared on
+   demand are zero too.  The allocator's statistics, printed at
+   shutdown, show how many requests each way served and what
+   they cost.
+
+   The test sleeps between rounds so that the idle thread has
+   time to refill the cache. */
+
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+#define ROUNDS 8                /* Rounds of allocation. */
+#define PAGE_CNT 16             /* Pages allocated per round. */
+
+static uint8_t *pages[PAGE_CNT];
+
+/* Allocates PAGE_CNT zeroed user pages, checks that they are
+   zero, dirties them, and frees them again. */
+static void
+zero_round (void) 
+{
+  int i;
+
+  for (i = 0; i < PAGE_CNT; i++) 
+    {
+      size_t ofs;
+
+      pages[i] = palloc_get_page (PAL_USER | PAL_ZERO);
+      if (pages[i] == NULL)
+        fail ("out of user pages");
+      for (ofs = 0; ofs < PGSIZE; ofs++)
+        if (pages[i][ofs] != 0)
+          fail ("page %d has nonzero byte at offset %zu", i, ofs);
+      memset (pages[i], 0xcc, PGSIZE);
+    }
+  for (i = 0; i < PAGE_CNT; i++)
+    palloc_free_page (pages[i]);
+}
+
+void
+test_palloc_zero (void) 
+{
+  size_t watermark = palloc_zero_watermark;
+  int i;
+
+  /* With the cache enabled, the idle thread clears pages while
+     we sleep. */
+  palloc_zero_watermark = PAGE_CNT;
+  for (i = 0; i < ROUNDS; i++) 
+    {
+      timer_msleep (50);
+      zero_round ();
+    }
+  msg ("pages from the zeroed-page cache are zero");
+
+  /* With the cache disabled, every request clears its page.  The
+     pages already cached may serve the first round. */
+  palloc_zero_watermark = 0;
+  for (i = 0; i <= ROUNDS; i++)
+    zero_round ();
+  palloc_zero_watermark = watermark;
+  msg ("pages cleared on demand are zero");
+  pass ();
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(palloc-zero) begin
+(palloc-zero) pages from the zeroed-page cache are zero
+(palloc-zero) pages cleared on demand are zero
+(palloc-zero) PASS
+(palloc-zero) end
+EOF
+pass;
@@ -0,0 +1,96 @@
+/* Measures how CPU-bound work scales with the number of CPUs.
+   Times one worker thread running a busy loop, then WORKER_CNT
+   workers each running the same loop at once.  On N CPUs the
+   workers should finish about min(N, WORKER_CNT) times faster
+   than one after another; the test fails if the speedup falls
+   below 3/4 of that.  Run it with "pintos --smp=4" to see the
+   workers spread over the CPUs. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of workers run at once. */
+#define WORKER_CNT 4
+
+/* Ticks one worker's loop should take. */
+#define TARGET_TICKS 50
+
+/* Work shared by a set of workers. */
+struct work
+  {
+    unsigned loops;             /* Iterations of the busy loop. */
+    struct semaphore done;      /* Upped by each worker when done. */
+  };
+
+static thread_func worker;
+static int64_t run_workers (int cnt, unsigned loops);
+
+void
+test_parallel_bench (void)
+{
+  unsigned cpu_cnt = thread_cpu_cnt ();
+  unsigned expected = cpu_cnt < WORKER_CNT ? cpu_cnt : WORKER_CNT;
+  unsigned loops;
+  int64_t one, all, speedup;
+
+  /* Find a loop count that takes about TARGET_TICKS ticks. */
+  loops = 1 << 16;
+  while ((one = run_workers (1, loops)) < TARGET_TICKS / 10)
+    loops *= 2;
+  loops = (uint64_t) loops * TARGET_TICKS / one;
+
+  one = run_workers (1, loops);
+  all = run_workers (WORKER_CNT, loops);
+  if (all <= 0)
+    all = 1;
+
+  /* Speedup over running the workers one after another, times
+     100. */
+  speedup = WORKER_CNT * one * 100 / all;
+  msg ("%u CPUs: 1 worker took %"PRId64" ticks, %d workers took %"PRId64
+       " ticks, speedup %"PRId64".%02"PRId64,
+       cpu_cnt, one, WORKER_CNT, all, speedup / 100, speedup % 100);
+  if (speedup < 75 * (int64_t) expected)
+    fail ("speedup %"PRId64".%02"PRId64" on %u CPUs is below %u.%02u",
+          speedup / 100, speedup % 100, cpu_cnt,
+          75 * expected / 100, 75 * expected % 100);
+  pass ();
+}
+
+/* Runs CNT workers at once, each doing LOOPS iterations of the
+   busy loop, and returns the timer ticks they took. */
+static int64_t
+run_workers (int cnt, unsigned loops)
+{
+  struct work work;
+  int64_t start;
+  int i;
+
+  work.loops = loops;
+  sema_init (&work.done, 0);
+
+  start = timer_ticks ();
+  for (i = 0; i < cnt; i++)
+    if (thread_create ("worker", PRI_DEFAULT, worker, &work) == TID_ERROR)
+      fail ("thread_create failed");
+  for (i = 0; i < cnt; i++)
+    sema_down (&work.done);
+  return timer_elapsed (start);
+}
+
+/* Runs the busy loop for the struct work in WORK_. */
+static void
+worker (void *work_)
+{
+  struct work *work = work_;
+  volatile unsigned i;
+
+  for (i = 0; i < work->loops; i++)
+    continue;
+  sema_up (&work->done);
+}
@@ -0,0 +1,130 @@
+/* Measures the cost of waking one thread from a semaphore and
+   from a condition variable as the number of waiting threads
+   grows.  Waiters have a spread of priorities lower than ours,
+   so each wake is pure wait-queue work, with no context switch.
+   With priority wait queues the cost should grow at most
+   logarithmically with the number of waiters, instead of
+   linearly (or worse) as it does when the queue is re-sorted on
+   every wake.  The test fails if waking one of MAX_WAITERS
+   waiters costs more than GROWTH_LIMIT times as much as waking
+   one of 16, a generous bound that still rules out linear
+   growth. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define MAX_WAITERS 128
+#define GROWTH_LIMIT 4
+
+static struct semaphore sema;
+static struct lock lock;
+static struct condition cond;
+static struct semaphore done;
+
+static thread_func sema_waiter;
+static thread_func cond_waiter;
+
+static void start_waiters (int cnt, thread_func *);
+static void finish_waiters (int cnt);
+
+void
+test_priority_wake_bench (void) 
+{
+  static const int counts[] = {1, 16, 64, MAX_WAITERS};
+  enum { COUNT_CNT = sizeof counts / sizeof *counts };
+  uint64_t sema_cycles[COUNT_CNT], cond_cycles[COUNT_CNT];
+  size_t i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&sema, 0);
+  lock_init (&lock);
+  cond_init (&cond);
+  sema_init (&done, 0);
+
+  for (i = 0; i < COUNT_CNT; i++) 
+    {
+      int cnt = counts[i];
+      uint64_t start;
+      int j;
+
+      start_waiters (cnt, sema_waiter);
+      start = timer_rdtsc ();
+      for (j = 0; j < cnt; j++)
+        sema_up (&sema);
+      sema_cycles[i] = (timer_rdtsc () - start) / cnt;
+      finish_waiters (cnt);
+
+      start_waiters (cnt, cond_waiter);
+      lock_acquire (&lock);
+      start = timer_rdtsc ();
+      for (j = 0; j < cnt; j++)
+        cond_signal (&cond, &lock);
+      cond_cycles[i] = (timer_rdtsc () - start) / cnt;
+      lock_release (&lock);
+      finish_waiters (cnt);
+
+      msg ("%3d waiters: sema_up %"PRIu64" cycles, "
+           "cond_signal %"PRIu64" cycles",
+           cnt, sema_cycles[i], cond_cycles[i]);
+    }
+
+  if (sema_cycles[COUNT_CNT - 1] > GROWTH_LIMIT * sema_cycles[1])
+    fail ("sema_up cost grew more than %dx from %d to %d waiters",
+          GROWTH_LIMIT, counts[1], MAX_WAITERS);
+  if (cond_cycles[COUNT_CNT - 1] > GROWTH_LIMIT * cond_cycles[1])
+    fail ("cond_signal cost grew more than %dx from %d to %d waiters",
+          GROWTH_LIMIT, counts[1], MAX_WAITERS);
+  pass ();
+}
+
+/* Creates CNT threads running FUNC at priorities below ours and
+   lets them all block. */
+static void
+start_waiters (int cnt, thread_func *func) 
+{
+  int i;
+
+  for (i = 0; i < cnt; i++) 
+    {
+      char name[24];
+      snprintf (name, sizeof name, "waiter %d", i);
+      thread_create (name, PRI_MIN + 1 + i % (PRI_DEFAULT - PRI_MIN - 1),
+                     func, NULL);
+    }
+
+  /* Drop below the waiters so that they all run up to their
+     wait, then take our priority back. */
+  thread_set_priority (PRI_MIN);
+  thread_set_priority (PRI_DEFAULT);
+}
+
+/* Waits for CNT woken waiters to exit. */
+static void
+finish_waiters (int cnt) 
+{
+  while (cnt-- > 0)
+    sema_down (&done);
+}
+
+static void
+sema_waiter (void *aux UNUSED) 
+{
+  sema_down (&sema);
+  sema_up (&done);
+}
+
+static void
+cond_waiter (void *aux UNUSED) 
+{
+  lock_acquire (&lock);
+  cond_wait (&cond, &lock);
+  lock_release (&lock);
+  sema_up (&done);
+}
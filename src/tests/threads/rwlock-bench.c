@@ -0,0 +1,91 @@
+/* Measures reader throughput under contention.  Several threads
+   repeatedly take a lock, sleep one tick while holding it (as if
+   waiting for I/O), and release it, for a fixed number of ticks.
+   This is done once with the threads holding a readers-writer
+   lock for reading and once with an ordinary lock.  Readers
+   share the readers-writer lock, so they should complete about
+   THREAD_CNT times as many operations as with the lock, which
+   serializes them. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 8
+#define TEST_TICKS 100
+
+static struct rwlock rwlock;
+static struct lock lock;
+static struct semaphore done;
+static int64_t deadline;
+static int ops;
+
+static thread_func rwlock_reader;
+static thread_func lock_reader;
+static int run (thread_func *);
+
+void
+test_rwlock_bench (void) 
+{
+  int rwlock_ops, lock_ops;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  rwlock_init (&rwlock);
+  lock_init (&lock);
+  sema_init (&done, 0);
+
+  rwlock_ops = run (rwlock_reader);
+  lock_ops = run (lock_reader);
+  msg ("%d threads, %d ticks: rwlock %d reads, lock %d reads",
+       THREAD_CNT, TEST_TICKS, rwlock_ops, lock_ops);
+  if (rwlock_ops <= lock_ops)
+    fail ("readers did not share the readers-writer lock");
+  pass ();
+}
+
+/* Runs THREAD_CNT threads executing FUNC for TEST_TICKS ticks
+   and returns the number of operations they completed. */
+static int
+run (thread_func *func) 
+{
+  int i;
+
+  ops = 0;
+  deadline = timer_ticks () + TEST_TICKS;
+  for (i = 0; i < THREAD_CNT; i++)
+    thread_create ("reader", PRI_DEFAULT, func, NULL);
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_down (&done);
+  return ops;
+}
+
+static void
+rwlock_reader (void *aux UNUSED) 
+{
+  while (timer_ticks () < deadline) 
+    {
+      rwlock_acquire_read (&rwlock);
+      timer_sleep (1);
+      rwlock_release_read (&rwlock);
+      ops++;
+    }
+  sema_up (&done);
+}
+
+static void
+lock_reader (void *aux UNUSED) 
+{
+  while (timer_ticks () < deadline) 
+    {
+      lock_acquire (&lock);
+      timer_sleep (1);
+      lock_release (&lock);
+      ops++;
+    }
+  sema_up (&done);
+}
@@ -0,0 +1,50 @@
+/* Three higher-priority threads acquire a readers-writer lock
+   for reading and go to sleep holding it.  All of them should
+   get the lock at once.  The main thread then acquires the lock
+   for writing, which must wait until every reader has released
+   it. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define READER_CNT 3
+
+static thread_func reader_thread_func;
+
+void
+test_rwlock_readers (void) 
+{
+  struct rwlock rwlock;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  rwlock_init (&rwlock);
+  for (i = 0; i < READER_CNT; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "reader %d", i);
+      thread_create (name, PRI_DEFAULT + 1, reader_thread_func, &rwlock);
+    }
+
+  msg ("main: acquiring for writing");
+  rwlock_acquire_write (&rwlock);
+  msg ("main: got the lock for writing with %u readers", rwlock.readers);
+  rwlock_release_write (&rwlock);
+}
+
+static void
+reader_thread_func (void *rwlock_) 
+{
+  struct rwlock *rwlock = rwlock_;
+
+  rwlock_acquire_read (rwlock);
+  msg ("%s: got the lock, %u readers", thread_name (), rwlock->readers);
+  timer_sleep (10);
+  rwlock_release_read (rwlock);
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-readers) begin
+(rwlock-readers) reader 0: got the lock, 1 readers
+(rwlock-readers) reader 1: got the lock, 2 readers
+(rwlock-readers) reader 2: got the lock, 3 readers
+(rwlock-readers) main: acquiring for writing
+(rwlock-readers) main: got the lock for writing with 0 readers
+(rwlock-readers) end
+EOF
+pass;
@@ -0,0 +1,48 @@
+/* Tests upgrading a read hold on a readers-writer lock to a
+   write hold and downgrading it back.  Then a higher-priority
+   writer starts waiting for the lock while the main thread reads
+   it, so an upgrade would deadlock and must fail instead. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func writer_thread_func;
+
+void
+test_rwlock_upgrade (void) 
+{
+  struct rwlock rwlock;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  rwlock_init (&rwlock);
+  rwlock_acquire_read (&rwlock);
+  if (!rwlock_upgrade (&rwlock))
+    fail ("upgrade failed with no other thread waiting");
+  msg ("upgraded: held for writing %s, %u readers",
+       rwlock_held_for_write (&rwlock) ? "yes" : "no", rwlock.readers);
+  rwlock_downgrade (&rwlock);
+  msg ("downgraded: held for writing %s, %u readers",
+       rwlock_held_for_write (&rwlock) ? "yes" : "no", rwlock.readers);
+
+  thread_create ("writer", PRI_DEFAULT + 1, writer_thread_func, &rwlock);
+  if (rwlock_upgrade (&rwlock))
+    fail ("upgrade succeeded while a writer was waiting");
+  msg ("upgrade refused while writer waits");
+  rwlock_release_read (&rwlock);
+  msg ("writer must already have finished.");
+}
+
+static void
+writer_thread_func (void *rwlock_) 
+{
+  struct rwlock *rwlock = rwlock_;
+
+  rwlock_acquire_write (rwlock);
+  msg ("writer: got the lock");
+  rwlock_release_write (rwlock);
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-upgrade) begin
+(rwlock-upgrade) upgraded: held for writing yes, 0 readers
+(rwlock-upgrade) downgraded: held for writing no, 1 readers
+(rwlock-upgrade) upgrade refused while writer waits
+(rwlock-upgrade) writer: got the lock
+(rwlock-upgrade) writer must already have finished.
+(rwlock-upgrade) end
+EOF
+pass;
@@ -0,0 +1,61 @@
+/* The main thread holds a readers-writer lock for reading.  A
+   higher-priority writer then waits for the lock, followed by a
+   reader of still higher priority.  Even though the lock is only
+   held for reading, the reader must wait behind the waiting
+   writer, and it donates its priority to the writer.  When the
+   main thread releases the lock, the writer should get it first,
+   then the reader. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func writer_thread_func;
+static thread_func reader_thread_func;
+static struct thread *writer;
+
+void
+test_rwlock_writer (void) 
+{
+  struct rwlock rwlock;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&rwlock);
+  rwlock_acquire_read (&rwlock);
+  thread_create ("writer", PRI_DEFAULT + 1, writer_thread_func, &rwlock);
+  thread_create ("reader", PRI_DEFAULT + 5, reader_thread_func, &rwlock);
+  msg ("Writer should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 5, writer->priority);
+  rwlock_release_read (&rwlock);
+  msg ("Writer and reader must already have finished.");
+}
+
+static void
+writer_thread_func (void *rwlock_) 
+{
+  struct rwlock *rwlock = rwlock_;
+
+  writer = thread_current ();
+  rwlock_acquire_write (rwlock);
+  msg ("writer: got the lock with priority %d", thread_get_priority ());
+  rwlock_release_write (rwlock);
+  msg ("writer: done");
+}
+
+static void
+reader_thread_func (void *rwlock_) 
+{
+  struct rwlock *rwlock = rwlock_;
+
+  rwlock_acquire_read (rwlock);
+  msg ("reader: got the lock");
+  rwlock_release_read (rwlock);
+  msg ("reader: done");
+}
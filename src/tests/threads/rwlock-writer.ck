@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-writer) begin
+(rwlock-writer) Writer should have priority 36.  Actual priority: 36.
+(rwlock-writer) writer: got the lock with priority 36
+(rwlock-writer) reader: got the lock
+(rwlock-writer) reader: done
+(rwlock-writer) writer: done
+(rwlock-writer) Writer and reader must already have finished.
+(rwlock-writer) end
+EOF
+pass;
@@ -0,0 +1,103 @@
+/* Checks the slab allocator with a cache of 540-byte objects,
+   the size of a struct inode, which malloc() would round up to
+   1024 bytes.  Checks that objects do not overlap, that the
+   constructor's work survives a free and a new allocation, that
+   more objects fit in a page than malloc() would fit, and that
+   the first objects of successive slabs are colored, that is, at
+   different offsets within their pages. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/slab.h"
+#include "threads/vaddr.h"
+
+#define OBJ_SIZE 540            /* Object size. */
+#define OBJ_CNT 64              /* Number of objects allocated. */
+#define CTOR_MAGIC 0x1234abcd   /* Set by constructor. */
+
+struct object
+  {
+    unsigned magic;             /* Set by the constructor. */
+    unsigned owner;             /* Index in objs[] while in use. */
+    char data[OBJ_SIZE - 2 * sizeof (unsigned)];
+  };
+
+static struct object *objs[OBJ_CNT];
+
+static void
+object_ctor (void *obj_) 
+{
+  struct object *obj = obj_;
+  obj->magic = CTOR_MAGIC;
+}
+
+void
+test_slab_cache (void) 
+{
+  struct kmem_cache *cache;
+  void *pages[OBJ_CNT];
+  size_t page_cnt = 0, color_cnt = 0;
+  size_t first_ofs = 0;
+  int i, j;
+
+  cache = kmem_cache_create ("slab-cache", sizeof (struct object),
+                             object_ctor);
+
+  for (i = 0; i < OBJ_CNT; i++) 
+    {
+      void *page;
+
+      objs[i] = kmem_cache_alloc (cache);
+      if (objs[i] == NULL)
+        fail ("allocation %d failed", i);
+      if (objs[i]->magic != CTOR_MAGIC)
+        fail ("object %d was not constructed", i);
+      objs[i]->owner = i;
+      memset (objs[i]->data, i, sizeof objs[i]->data);
+
+      /* Count the pages used, and the offsets at which new pages
+         start handing out objects. */
+      page = pg_round_down (objs[i]);
+      for (j = 0; j < (int) page_cnt; j++)
+        if (pages[j] == page)
+          break;
+      if (j == (int) page_cnt) 
+        {
+          if (page_cnt == 0 || pg_ofs (objs[i]) != first_ofs)
+            color_cnt++;
+          if (page_cnt == 0)
+            first_ofs = pg_ofs (objs[i]);
+          pages[page_cnt++] = page;
+        }
+    }
+
+  for (i = 0; i < OBJ_CNT; i++)
+    if (objs[i]->owner != (unsigned) i
+        || objs[i]->data[sizeof objs[i]->data - 1] != (char) i)
+      fail ("object %d was overwritten", i);
+  msg ("objects do not overlap");
+
+  /* Free every other object, reallocate, and check that the
+     constructed state is still there. */
+  for (i = 0; i < OBJ_CNT; i += 2)
+    kmem_cache_free (cache, objs[i]);
+  for (i = 0; i < OBJ_CNT; i += 2) 
+    {
+      objs[i] = kmem_cache_alloc (cache);
+      if (objs[i] == NULL || objs[i]->magic != CTOR_MAGIC)
+        fail ("reallocated object %d lost its constructed state", i);
+    }
+  for (i = 0; i < OBJ_CNT; i++)
+    kmem_cache_free (cache, objs[i]);
+  msg ("constructed state survives a free");
+
+  if (page_cnt > OBJ_CNT / (PGSIZE / sizeof (struct object)) + 1)
+    fail ("%d objects of %zu bytes took %zu pages",
+          OBJ_CNT, sizeof (struct object), page_cnt);
+  msg ("objects are packed into pages");
+  if (page_cnt > 1 && color_cnt < 2)
+    fail ("slabs are not colored");
+  msg ("slabs are colored");
+  pass ();
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(slab-cache) begin
+(slab-cache) objects do not overlap
+(slab-cache) constructed state survives a free
+(slab-cache) objects are packed into pages
+(slab-cache) slabs are colored
+(slab-cache) PASS
+(slab-cache) end
+EOF
+pass;
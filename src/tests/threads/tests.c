@@ -17,6 +17,7 @@ static const struct test tests[] =
     {"alarm-priority", test_alarm_priority},
     {"alarm-zero", test_alarm_zero},
     {"alarm-negative", test_alarm_negative},
+    {"alarm-hires", test_alarm_hires},
     {"priority-change", test_priority_change},
     {"priority-donate-one", test_priority_donate_one},
     {"priority-donate-multiple", test_priority_donate_multiple},
@@ -29,6 +30,21 @@ static const struct test tests[] =
     {"priority-preempt", test_priority_preempt},
     {"priority-sema", test_priority_sema},
     {"priority-condvar", test_priority_condvar},
+    {"priority-wake-bench", test_priority_wake_bench},
+    {"rwlock-readers", test_rwlock_readers},
+    {"rwlock-writer", test_rwlock_writer},
+    {"rwlock-upgrade", test_rwlock_upgrade},
+    {"rwlock-bench", test_rwlock_bench},
+    {"thread-spawn-bench", test_thread_spawn_bench},
+    {"workqueue", test_workqueue},
+    {"edf-deadline", test_edf_deadline},
+    {"wake-batch-bench", test_wake_batch_bench},
+    {"palloc-bench", test_palloc_bench},
+    {"palloc-zero", test_palloc_zero},
+    {"palloc-borrow", test_palloc_borrow},
+    {"slab-cache", test_slab_cache},
+    {"malloc-frag", test_malloc_frag},
+    {"parallel-bench", test_parallel_bench},
     {"mlfqs-load-1", test_mlfqs_load_1},
     {"mlfqs-load-60", test_mlfqs_load_60},
     {"mlfqs-load-avg", test_mlfqs_load_avg},
@@ -11,6 +11,7 @@ extern test_func test_alarm_simultaneous;
 extern test_func test_alarm_priority;
 extern test_func test_alarm_zero;
 extern test_func test_alarm_negative;
+extern test_func test_alarm_hires;
 extern test_func test_priority_change;
 extern test_func test_priority_donate_one;
 extern test_func test_priority_donate_multiple;
@@ -23,6 +24,21 @@ extern test_func test_priority_fifo;
 extern test_func test_priority_preempt;
 extern test_func test_priority_sema;
 extern test_func test_priority_condvar;
+extern test_func test_priority_wake_bench;
+extern test_func test_rwlock_readers;
+extern test_func test_rwlock_writer;
+extern test_func test_rwlock_upgrade;
+extern test_func test_rwlock_bench;
+extern test_func test_thread_spawn_bench;
+extern test_func test_workqueue;
+extern test_func test_edf_deadline;
+extern test_func test_wake_batch_bench;
+extern test_func test_palloc_bench;
+extern test_func test_palloc_zero;
+extern test_func test_palloc_borrow;
+extern test_func test_slab_cache;
+extern test_func test_malloc_frag;
+extern test_func test_parallel_bench;
 extern test_func test_mlfqs_load_1;
 extern test_func test_mlfqs_load_60;
 extern test_func test_mlfqs_load_avg;
@@ -0,0 +1,52 @@
+/* Measures how fast threads can be created and joined.  The main
+   thread repeatedly creates a higher-priority thread, which runs
+   at once, signals a semaphore, and exits; the main thread then
+   waits on the semaphore.  Reports threads created per second. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 1000
+
+static thread_func child;
+
+void
+test_thread_spawn_bench (void) 
+{
+  struct semaphore done;
+  int64_t start, elapsed;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&done, 0);
+  start = timer_now_ns ();
+  for (i = 0; i < THREAD_CNT; i++) 
+    {
+      if (thread_create ("child", PRI_DEFAULT + 1, child, &done) == TID_ERROR)
+        fail ("thread_create failed after %d threads", i);
+      sema_down (&done);
+    }
+  elapsed = timer_now_ns () - start;
+  if (elapsed <= 0)
+    elapsed = 1;
+
+  msg ("%d threads spawned and joined in %"PRId64" us, %"PRId64" per second",
+       THREAD_CNT, elapsed / 1000,
+       (int64_t) THREAD_CNT * 1000000000 / elapsed);
+  pass ();
+}
+
+static void
+child (void *done_) 
+{
+  struct semaphore *done = done_;
+
+  sema_up (done);
+}
@@ -0,0 +1,133 @@
+/* Counts the context switches it takes to wake every waiter on
+   a condition variable and let them all finish, as the number of
+   waiters grows.  The waiters all have higher priorities than
+   ours.  A waiter that runs as soon as it is woken, while we
+   still hold the lock, only blocks on the lock again: that costs
+   two switches, and another to get back to it later.  With
+   batched wakeups, the waiters instead first run when we release
+   the lock, and none of them has to block on it.  The test fails
+   if waking N waiters either way takes more than N + 1 switches,
+   which unbatched wakeups exceed at every N. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define MAX_WAITERS 32
+
+static struct lock lock;
+static struct condition cond;
+static struct semaphore done;
+static unsigned waiter_switches;
+
+static thread_func waiter;
+
+static unsigned wake_all (int cnt, bool broadcast, uint64_t *cycles);
+static unsigned switch_count (void);
+
+void
+test_wake_batch_bench (void) 
+{
+  static const int counts[] = {1, 4, 16, MAX_WAITERS};
+  size_t i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  lock_init (&lock);
+  cond_init (&cond);
+  sema_init (&done, 0);
+
+  for (i = 0; i < sizeof counts / sizeof *counts; i++) 
+    {
+      int cnt = counts[i];
+      uint64_t signal_cycles, broadcast_cycles;
+      unsigned signal_switches, broadcast_switches;
+
+      signal_switches = wake_all (cnt, false, &signal_cycles);
+      broadcast_switches = wake_all (cnt, true, &broadcast_cycles);
+      msg ("%2d waiters: cond_signal each %u switches, %"PRIu64" cycles; "
+           "cond_broadcast %u switches, %"PRIu64" cycles",
+           cnt, signal_switches, signal_cycles,
+           broadcast_switches, broadcast_cycles);
+      if (signal_switches > (unsigned) cnt + 1)
+        fail ("cond_signal to %d waiters took %u switches",
+              cnt, signal_switches);
+      if (broadcast_switches > (unsigned) cnt + 1)
+        fail ("cond_broadcast to %d waiters took %u switches",
+              cnt, broadcast_switches);
+    }
+  pass ();
+}
+
+/* Starts CNT waiters and wakes them all, with cond_broadcast()
+   if BROADCAST is true, otherwise with one cond_signal() per
+   waiter.  Stores the cycles the wakeup itself took in *CYCLES.
+   Returns the number of context switches from the wakeup until
+   every waiter is done, not counting each waiter's switch away
+   to wait in the first place. */
+static unsigned
+wake_all (int cnt, bool broadcast, uint64_t *cycles) 
+{
+  unsigned switches;
+  uint64_t start;
+  int i;
+
+  /* Each waiter outranks us, so it runs up to its wait as soon
+     as it is created. */
+  for (i = 0; i < cnt; i++) 
+    {
+      char name[24];
+      snprintf (name, sizeof name, "waiter %d", i);
+      thread_create (name, PRI_DEFAULT + 1 + i % (PRI_MAX - PRI_DEFAULT),
+                     waiter, NULL);
+    }
+
+  waiter_switches = 0;
+  lock_acquire (&lock);
+  switches = switch_count ();
+  start = timer_rdtsc ();
+  if (broadcast)
+    cond_broadcast (&cond, &lock);
+  else
+    for (i = 0; i < cnt; i++)
+      cond_signal (&cond, &lock);
+  *cycles = timer_rdtsc () - start;
+  lock_release (&lock);
+
+  for (i = 0; i < cnt; i++)
+    sema_down (&done);
+  switches = switch_count () - switches;
+  return switches + waiter_switches - cnt;
+}
+
+/* Returns the number of times the running thread has been
+   switched away from. */
+static unsigned
+switch_count (void) 
+{
+  struct sched_stats s;
+
+  thread_get_stats (thread_current (), &s);
+  return s.voluntary_switches + s.involuntary_switches;
+}
+
+/* Waits on the condition variable and adds the switches away
+   from this thread since then, including the wait itself, to
+   waiter_switches. */
+static void
+waiter (void *aux UNUSED) 
+{
+  unsigned start;
+
+  lock_acquire (&lock);
+  start = switch_count ();
+  cond_wait (&cond, &lock);
+  waiter_switches += switch_count () - start;
+  lock_release (&lock);
+  sema_up (&done);
+}
@@ -0,0 +1,76 @@
+/* Checks the kernel workqueue.  A work item queues one item of
+   each priority, lowest first; they must run highest priority
+   first.  Then one delayed item is cancelled before its delay
+   passes and another is left to run, which it must do no sooner
+   than its delay. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+#include "devices/timer.h"
+
+static struct work first, low, normal, high, delayed, cancelled;
+static struct semaphore done;
+static int64_t queued_at;
+
+static work_func first_func, say_func, delayed_func;
+
+void
+test_workqueue (void) 
+{
+  sema_init (&done, 0);
+
+  /* Priority order. */
+  work_init (&first, first_func, NULL, WORK_PRI_NORMAL);
+  work_init (&low, say_func, "low", WORK_PRI_LOW);
+  work_init (&normal, say_func, "normal", WORK_PRI_NORMAL);
+  work_init (&high, say_func, "high", WORK_PRI_HIGH);
+  work_queue (&first);
+  sema_down (&done);
+
+  /* Delays and cancellation. */
+  work_init (&delayed, delayed_func, NULL, WORK_PRI_NORMAL);
+  work_init (&cancelled, say_func, "cancelled", WORK_PRI_NORMAL);
+  queued_at = timer_ticks ();
+  work_queue_delayed (&delayed, 10);
+  work_queue_delayed (&cancelled, 5);
+  if (work_queue_delayed (&delayed, 10))
+    fail ("work_queue_delayed() queued a pending item twice");
+  msg ("cancel returned %s", work_cancel (&cancelled) ? "true" : "false");
+  sema_down (&done);
+  timer_sleep (10);
+  if (work_pending (&cancelled))
+    fail ("cancelled item still pending");
+}
+
+/* Queues the other items from a worker, so that none of them
+   can run until this function returns. */
+static void
+first_func (void *aux UNUSED) 
+{
+  msg ("first item running");
+  work_queue (&low);
+  work_queue (&normal);
+  work_queue (&high);
+}
+
+static void
+say_func (void *name) 
+{
+  msg ("%s", (const char *) name);
+  if (name == low.aux)
+    sema_up (&done);
+}
+
+static void
+delayed_func (void *aux UNUSED) 
+{
+  if (timer_elapsed (queued_at) < 10)
+    fail ("delayed item ran after only %lld ticks",
+          (long long) timer_elapsed (queued_at));
+  msg ("delayed item ran after at least 10 ticks");
+  sema_up (&done);
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(workqueue) begin
+(workqueue) first item running
+(workqueue) high
+(workqueue) normal
+(workqueue) low
+(workqueue) cancel returned true
+(workqueue) delayed item ran after at least 10 ticks
+(workqueue) end
+EOF
+pass;
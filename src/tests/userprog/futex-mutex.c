@@ -0,0 +1,67 @@
+/* Creates several threads that each increment a shared counter
+   many times under a futex-based mutex, spinning now and then
+   while holding it so that timer preemption causes contention,
+   and waits on a condition variable until all of them have
+   finished.  The counter must come out exact. */
+
+#include <synch.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define THREAD_CNT 4
+#define ITERATIONS 200
+
+static struct mutex mutex = MUTEX_INITIALIZER;
+static struct condvar done_cv = CONDVAR_INITIALIZER;
+static int counter;
+static int done_cnt;
+
+static void
+incrementer (void *aux UNUSED) 
+{
+  int i;
+
+  for (i = 0; i < ITERATIONS; i++) 
+    {
+      volatile int spin;
+      int old;
+
+      mutex_lock (&mutex);
+      old = counter;
+      if (i % 16 == 0)
+        for (spin = 0; spin < 100000; spin++)
+          continue;
+      counter = old + 1;
+      mutex_unlock (&mutex);
+    }
+
+  mutex_lock (&mutex);
+  done_cnt++;
+  condvar_signal (&done_cv, &mutex);
+  mutex_unlock (&mutex);
+  thread_exit (0);
+}
+
+void
+test_main (void) 
+{
+  tid_t tids[THREAD_CNT];
+  int i;
+
+  for (i = 0; i < THREAD_CNT; i++)
+    CHECK ((tids[i] = thread_create (incrementer, NULL)) != TID_ERROR,
+           "create thread %d", i);
+
+  mutex_lock (&mutex);
+  while (done_cnt < THREAD_CNT)
+    condvar_wait (&done_cv, &mutex);
+  mutex_unlock (&mutex);
+  msg ("all threads done, counter %d", counter);
+
+  for (i = 0; i < THREAD_CNT; i++)
+    thread_join (tids[i]);
+
+  CHECK (futex_wait (&counter, counter + 1) == -1,
+         "futex_wait with stale value returns at once");
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(futex-mutex) begin
+(futex-mutex) create thread 0
+(futex-mutex) create thread 1
+(futex-mutex) create thread 2
+(futex-mutex) create thread 3
+(futex-mutex) all threads done, counter 800
+(futex-mutex) futex_wait with stale value returns at once
+(futex-mutex) end
+futex-mutex: exit(0)
+EOF
+pass;
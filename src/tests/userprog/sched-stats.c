@@ -0,0 +1,22 @@
+/* Tests the sched_stats system call, on the calling thread and
+   on a thread that does not exist. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  struct sched_stats s;
+
+  CHECK (sched_stats (0, &s), "sched_stats (0)");
+  if (s.tid <= 0)
+    fail ("bad tid %d", s.tid);
+  if (strcmp (s.name, "sched-stats"))
+    fail ("name is \"%s\", not \"sched-stats\"", s.name);
+  if (s.scheduled == 0)
+    fail ("never scheduled");
+  CHECK (!sched_stats (-1, &s), "sched_stats (-1) must fail");
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(sched-stats) begin
+(sched-stats) sched_stats (0)
+(sched-stats) sched_stats (-1) must fail
+(sched-stats) end
+sched-stats: exit(0)
+EOF
+pass;
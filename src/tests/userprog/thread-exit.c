@@ -0,0 +1,31 @@
+/* Creates a thread that calls exit() while the main thread
+   waits to join it.  The whole process must exit, with the
+   status that the thread passed. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Set once the main thread has reported creating us, so that
+   the output does not depend on which thread runs first. */
+static volatile bool go;
+
+static void
+exiter (void *aux UNUSED) 
+{
+  while (!go)
+    continue;
+  exit (57);
+}
+
+void
+test_main (void) 
+{
+  tid_t tid;
+
+  CHECK ((tid = thread_create (exiter, NULL)) != TID_ERROR,
+         "create thread");
+  go = true;
+  thread_join (tid);
+  fail ("should have exited with 57");
+}
@@ -0,0 +1,33 @@
+/* Creates a thread that dereferences a null pointer while the
+   main thread waits to join it.  The fault must terminate the
+   whole process with a -1 exit code, not just the thread. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Set once the main thread has reported creating us, so that
+   the output does not depend on which thread runs first. */
+static volatile bool go;
+
+static void
+faulter (void *aux UNUSED) 
+{
+  while (!go)
+    continue;
+  msg ("Congratulations - you have successfully dereferenced NULL: %d",
+       *(int *) NULL);
+  thread_exit (0);
+}
+
+void
+test_main (void) 
+{
+  tid_t tid;
+
+  CHECK ((tid = thread_create (faulter, NULL)) != TID_ERROR,
+         "create thread");
+  go = true;
+  thread_join (tid);
+  fail ("should have exited with -1");
+}
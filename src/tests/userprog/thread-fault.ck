@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_USER_FAULTS => 1, [<<'EOF']);
+(thread-fault) begin
+(thread-fault) create thread
+thread-fault: exit(-1)
+EOF
+pass;
@@ -0,0 +1,40 @@
+/* Creates several threads in this process, each of which adds
+   to its own slot of a shared array and exits with a status of
+   its own, and joins them all.  Also checks that a thread cannot
+   be joined twice. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define THREAD_CNT 4
+
+static int sums[THREAD_CNT];
+
+static void
+adder (void *i_) 
+{
+  int i = (int) i_;
+  int j;
+
+  for (j = 0; j <= 100 * i; j++)
+    sums[i] += j;
+  thread_exit (10 + i);
+}
+
+void
+test_main (void) 
+{
+  tid_t tids[THREAD_CNT];
+  int i;
+
+  for (i = 0; i < THREAD_CNT; i++)
+    CHECK ((tids[i] = thread_create (adder, (void *) i)) != TID_ERROR,
+           "create thread %d", i);
+  for (i = 0; i < THREAD_CNT; i++) 
+    {
+      int status = thread_join (tids[i]);
+      msg ("thread %d exited with status %d, sum %d", i, status, sums[i]);
+    }
+  CHECK (thread_join (tids[0]) == -1, "join thread 0 again");
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(thread-join) begin
+(thread-join) create thread 0
+(thread-join) create thread 1
+(thread-join) create thread 2
+(thread-join) create thread 3
+(thread-join) thread 0 exited with status 10, sum 0
+(thread-join) thread 1 exited with status 11, sum 5050
+(thread-join) thread 2 exited with status 12, sum 20100
+(thread-join) thread 3 exited with status 13, sum 45150
+(thread-join) join thread 0 again
+(thread-join) end
+thread-join: exit(0)
+EOF
+pass;
@@ -20,8 +20,11 @@
 #include "threads/loader.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/profile.h"
 #include "threads/pte.h"
+#include "threads/smp.h"
 #include "threads/thread.h"
+#include "threads/workqueue.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -54,7 +57,7 @@ static const char *swap_bdev_name;
 #endif
 #endif /* FILESYS */
 
-/* -ul: Maximum number of pages to put into palloc's user pool. */
+/* -ul: Maximum number of user pages palloc may hand out. */
 static size_t user_page_limit = SIZE_MAX;
 
 static void bss_init (void);
@@ -94,6 +97,10 @@ main (void)
   printf ("Pintos booting with %'"PRIu32" kB RAM...\n",
           init_ram_pages * PGSIZE / 1024);
 
+  /* Find the other CPUs, before the page allocator can reuse the
+     memory that describes them. */
+  smp_init ();
+
   /* Initialize memory system. */
   palloc_init (user_page_limit);
   malloc_init ();
@@ -116,10 +123,15 @@ main (void)
 #endif
 
   /* Start thread scheduler and enable interrupts. */
+  workqueue_init ();
   thread_start ();
+  workqueue_start ();
   serial_init_queue ();
   timer_calibrate ();
 
+  /* Start the other CPUs. */
+  smp_start ();
+
 #ifdef FILESYS
   /* Initialize file system. */
   ide_init ();
@@ -256,6 +268,36 @@ parse_options (char **argv)
         random_init (atoi (value));
       else if (!strcmp (name, "-mlfqs"))
         thread_mlfqs = true;
+      else if (!strcmp (name, "-o"))
+        {
+          /* Accept both "-o=OPTION" and "-o OPTION". */
+          if (value == NULL && argv[1] != NULL)
+            value = *++argv;
+          if (value != NULL && !strcmp (value, "mlfqs"))
+            thread_mlfqs = true;
+          else if (value != NULL && !strcmp (value, "profile"))
+            profile_enabled = true;
+          else
+            PANIC ("unknown -o option `%s' (use -h for help)",
+                   value != NULL ? value : "");
+        }
+      else if (!strcmp (name, "-tickless"))
+        timer_tickless = true;
+      else if (!strcmp (name, "-inline-timers"))
+        timer_inline_events = true;
+      else if (!strcmp (name, "-ts"))
+        {
+          int ticks = atoi (value);
+          if (ticks < 1)
+            PANIC ("time slice must be at least one tick");
+          thread_time_slice = ticks;
+        }
+      else if (!strcmp (name, "-dd"))
+        lock_donation_depth = atoi (value);
+      else if (!strcmp (name, "-lockprof"))
+        lock_profile = true;
+      else if (!strcmp (name, "-zp"))
+        palloc_zero_watermark = atoi (value);
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
@@ -379,6 +421,15 @@ usage (void)
 #endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+          "  -o mlfqs           Same as -mlfqs.\n"
+          "  -o profile         Sample the CPU at each timer tick, print at\n"
+          "                     power off (see utils/backtrace --profile).\n"
+          "  -ts=TICKS          Preempt threads after TICKS timer ticks.\n"
+          "  -tickless          Stop the periodic timer tick while idle.\n"
+          "  -inline-timers     Fire timer events in the interrupt handler.\n"
+          "  -dd=DEPTH          Donate priority through at most DEPTH locks.\n"
+          "  -lockprof          Profile lock contention, print at shutdown.\n"
+          "  -zp=PAGES          Keep up to PAGES zeroed pages ready (default 32).\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
@@ -6,9 +6,15 @@
 #include "threads/flags.h"
 #include "threads/intr-stubs.h"
 #include "threads/io.h"
+#include "threads/smp.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#include "devices/lapic.h"
 #include "devices/timer.h"
+#ifdef USERPROG
+#include "userprog/process.h"
+#include "userprog/syscall.h"
+#endif
 
 /* Programmable Interrupt Controller (PIC) registers.
    A PC has two PICs, called the master and slave PICs, with the
@@ -43,9 +49,58 @@ static unsigned int unexpected_cnt[INTR_CNT];
    pre-empted.  Handlers for external interrupts also may not
    sleep, although they may invoke intr_yield_on_return() to
    request that a new process be scheduled just before the
-   interrupt returns. */
-static bool in_external_intr;   /* Are we processing an external interrupt? */
-static bool yield_on_return;    /* Should we yield on interrupt return? */
+   interrupt returns.  Each CPU handles its own external
+   interrupts, so these are kept per CPU. */
+static bool in_external_intr[CPU_MAX]; /* Are we processing an external
+                                          interrupt? */
+static bool yield_on_return[CPU_MAX];  /* Should we yield on interrupt
+                                          return? */
+
+/* Kernel lock.
+
+   The kernel protects its data from interrupt handlers and from
+   other threads by turning interrupts off.  On more than one CPU
+   that is not enough, so once intr_lock_init() has been called,
+   a CPU that turns interrupts off also takes the kernel lock, a
+   spin lock, and releases it when it turns them back on.  A CPU
+   thus holds the kernel lock exactly when it has interrupts off,
+   and code that runs with interrupts off excludes other CPUs as
+   well as interrupt handlers, without any change to it.  Code
+   that runs with interrupts on, including threads that sleep on
+   a struct lock, runs on all CPUs at once.
+
+   The lock belongs to the CPU, not to a thread: a thread switch
+   happens with interrupts off, and the thread switched to goes
+   on holding the lock until it turns interrupts on.  An
+   interrupt that arrives while interrupts are on turns them off
+   on entry, so intr_handler() takes the lock then, and releases
+   it if interrupts are about to come back on when it returns. */
+static bool kernel_lock_used;   /* Has intr_lock_init() been called? */
+static volatile uint32_t kernel_locked; /* 1 if held, 0 if not. */
+
+/* Per-vector statistics.  Cycles are counted with the TSC from
+   entry to intr_handler() until the handler returns.  Handlers
+   that run with interrupts on, such as the system call handler,
+   may sleep, so for them this is elapsed time, not time spent
+   with interrupts off. */
+struct intr_stat 
+  {
+    long long cnt;              /* # of invocations. */
+    uint64_t cycles;            /* Total cycles in handler. */
+    uint64_t max_cycles;        /* Most cycles in one invocation. */
+  };
+static struct intr_stat intr_stats[INTR_CNT];
+
+/* Interrupts-off windows.  A window opens when intr_disable()
+   turns interrupts off, or when an external interrupt arrives
+   while they were on, and closes when intr_enable() turns them
+   back on or the interrupt returns.  A window may span thread
+   switches. */
+static uint64_t off_start[CPU_MAX]; /* TSC at start of open window,
+                                      or 0, per CPU. */
+static void *off_where[CPU_MAX]; /* Code that opened it, per CPU. */
+static uint64_t off_max;        /* Longest window so far. */
+static void *off_max_where;     /* Code that opened the longest. */
 
 /* Programmable Interrupt Controller helpers. */
 static void pic_init (void);
@@ -59,6 +114,12 @@ static inline uint64_t make_idtr_operand (uint16_t limit, void *base);
 /* Interrupt handlers. */
 void intr_handler (struct intr_frame *args);
 static void unexpected_interrupt (const struct intr_frame *);
+
+static enum intr_level disable_from (void *where);
+static void off_window_begin (void *where);
+static void off_window_end (void);
+static void kernel_lock (void);
+static void kernel_unlock (void);
 
 /* Returns the current interrupt status. */
 enum intr_level
@@ -80,7 +141,8 @@ intr_get_level (void)
 enum intr_level
 intr_set_level (enum intr_level level) 
 {
-  return level == INTR_ON ? intr_enable () : intr_disable ();
+  return (level == INTR_ON ? intr_enable ()
+          : disable_from (__builtin_return_address (0)));
 }
 
 /* Enables interrupts and returns the previous interrupt status. */
@@ -90,6 +152,12 @@ intr_enable (void)
   enum intr_level old_level = intr_get_level ();
   ASSERT (!intr_context ());
 
+  if (old_level == INTR_OFF)
+    {
+      off_window_end ();
+      kernel_unlock ();
+    }
+
   /* Enable interrupts by setting the interrupt flag.
 
      See [IA32-v2b] "STI" and [IA32-v3a] 5.8.1 "Masking Maskable
@@ -102,6 +170,15 @@ intr_enable (void)
 /* Disables interrupts and returns the previous interrupt status. */
 enum intr_level
 intr_disable (void) 
+{
+  return disable_from (__builtin_return_address (0));
+}
+
+/* Disables interrupts and returns the previous interrupt status.
+   If interrupts were on, opens an interrupts-off window that is
+   blamed on WHERE. */
+static enum intr_level
+disable_from (void *where) 
 {
   enum intr_level old_level = intr_get_level ();
 
@@ -110,8 +187,110 @@ intr_disable (void)
      Hardware Interrupts". */
   asm volatile ("cli" : : : "memory");
 
+  if (old_level == INTR_ON)
+    {
+      kernel_lock ();
+      off_window_begin (where);
+    }
+
   return old_level;
 }
+
+/* Opens an interrupts-off window, blamed on WHERE.  Interrupts
+   must be off. */
+static void
+off_window_begin (void *where) 
+{
+  unsigned cpu = thread_cpu_id ();
+
+  off_start[cpu] = timer_rdtsc ();
+  off_where[cpu] = where;
+}
+
+/* Closes the open interrupts-off window, if any, and keeps track
+   of the longest.  Interrupts must be off. */
+static void
+off_window_end (void) 
+{
+  unsigned cpu = thread_cpu_id ();
+
+  if (off_start[cpu] != 0) 
+    {
+      uint64_t cycles = timer_rdtsc () - off_start[cpu];
+      if (cycles > off_max) 
+        {
+          off_max = cycles;
+          off_max_where = off_where[cpu];
+        }
+      off_start[cpu] = 0;
+    }
+}
+
+/* Takes the kernel lock, spinning until it is free, if the
+   kernel lock is in use.  Interrupts must be off. */
+static void
+kernel_lock (void) 
+{
+  uint32_t locked;
+
+  if (!kernel_lock_used)
+    return;
+
+  /* Atomically exchange 1 for the lock's value until the value
+     we get back is 0.  See [IA32-v2b] "XCHG". */
+  do
+    {
+      while (kernel_locked)
+        asm volatile ("pause");
+      locked = 1;
+      asm volatile ("xchgl %0, %1"
+                    : "+r" (locked), "+m" (kernel_locked) : : "memory");
+    }
+  while (locked != 0);
+}
+
+/* Releases the kernel lock, if it is in use.  Interrupts must be
+   off. */
+static void
+kernel_unlock (void) 
+{
+  if (kernel_lock_used)
+    {
+      barrier ();
+      kernel_locked = 0;
+    }
+}
+
+/* Starts using the kernel lock.  Must be called by the boot CPU,
+   with interrupts on, before any other CPU is started. */
+void
+intr_lock_init (void) 
+{
+  ASSERT (intr_get_level () == INTR_ON);
+
+  kernel_lock_used = true;
+}
+
+/* Enables interrupts and halts the CPU until the next interrupt
+   arrives.  Interrupts must be off.
+
+   The `sti' instruction disables interrupts until the completion
+   of the next instruction, so these two instructions are
+   executed atomically.  This atomicity is important; otherwise,
+   an interrupt could be handled between re-enabling interrupts
+   and waiting for the next one to occur, wasting as much as one
+   clock tick worth of time.
+
+   See [IA32-v2a] "HLT", [IA32-v2b] "STI", and [IA32-v3a]
+   7.11.1 "HLT Instruction". */
+void
+intr_halt (void) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  kernel_unlock ();
+  asm volatile ("sti; hlt" : : : "memory");
+}
 
 /* Initializes the interrupt system. */
 void
@@ -157,6 +336,21 @@ intr_init (void)
   intr_names[19] = "#XF SIMD Floating-Point Exception";
 }
 
+/* Sets up interrupts on an application processor, which shares
+   the boot CPU's IDT.  The processor starts with interrupts off,
+   so it takes the kernel lock to match. */
+void
+intr_init_ap (void) 
+{
+  uint64_t idtr_operand;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  idtr_operand = make_idtr_operand (sizeof idt - 1, idt);
+  asm volatile ("lidt %0" : : "m" (idtr_operand));
+  kernel_lock ();
+}
+
 /* Registers interrupt VEC_NO to invoke HANDLER with descriptor
    privilege level DPL.  Names the interrupt NAME for debugging
    purposes.  The interrupt handler will be invoked with
@@ -176,12 +370,14 @@ register_handler (uint8_t vec_no, int dpl, enum intr_level level,
 
 /* Registers external interrupt VEC_NO to invoke HANDLER, which
    is named NAME for debugging purposes.  The handler will
-   execute with interrupts disabled. */
+   execute with interrupts disabled.  VEC_NO is a PIC interrupt
+   or one delivered by the local APIC (see devices/lapic.h). */
 void
 intr_register_ext (uint8_t vec_no, intr_handler_func *handler,
                    const char *name) 
 {
-  ASSERT (vec_no >= 0x20 && vec_no <= 0x2f);
+  ASSERT ((vec_no >= 0x20 && vec_no <= 0x2f)
+          || (vec_no >= LAPIC_TIMER_VEC && vec_no < LAPIC_SPURIOUS_VEC));
   register_handler (vec_no, 0, INTR_OFF, handler, name);
 }
 
@@ -202,16 +398,19 @@ void
 intr_register_int (uint8_t vec_no, int dpl, enum intr_level level,
                    intr_handler_func *handler, const char *name)
 {
-  ASSERT (vec_no < 0x20 || vec_no > 0x2f);
+  ASSERT (vec_no < 0x20 || (vec_no > 0x2f && vec_no < LAPIC_TIMER_VEC));
   register_handler (vec_no, dpl, level, handler, name);
 }
 
 /* Returns true during processing of an external interrupt
-   and false at all other times. */
+   and false at all other times.  External interrupts are handled
+   with interrupts off, so with interrupts on the answer is false
+   without a look at which CPU we are on. */
 bool
 intr_context (void) 
 {
-  return in_external_intr;
+  return (intr_get_level () == INTR_OFF
+          && in_external_intr[thread_cpu_id ()]);
 }
 
 /* During processing of an external interrupt, directs the
@@ -222,7 +421,7 @@ void
 intr_yield_on_return (void) 
 {
   ASSERT (intr_context ());
-  yield_on_return = true;
+  yield_on_return[thread_cpu_id ()] = true;
 }
 
 /* 8259A Programmable Interrupt Controller. */
@@ -346,26 +545,43 @@ intr_handler (struct intr_frame *frame)
 {
   bool external;
   intr_handler_func *handler;
+  struct intr_stat *stat = &intr_stats[frame->vec_no];
+  uint64_t start;
+  uint64_t cycles;
+  unsigned cpu;
+
+  /* If the CPU turned interrupts off to deliver this interrupt,
+     take the kernel lock to match. */
+  if ((frame->eflags & FLAG_IF) && intr_get_level () == INTR_OFF)
+    kernel_lock ();
+  start = timer_rdtsc ();
+  cpu = thread_cpu_id ();
 
   /* External interrupts are special.
      We only handle one at a time (so interrupts must be off)
-     and they need to be acknowledged on the PIC (see below).
+     and they need to be acknowledged on the PIC or the local
+     APIC (see below).
      An external interrupt handler cannot sleep. */
-  external = frame->vec_no >= 0x20 && frame->vec_no < 0x30;
+  external = ((frame->vec_no >= 0x20 && frame->vec_no < 0x30)
+              || (frame->vec_no >= LAPIC_TIMER_VEC
+                  && frame->vec_no < LAPIC_SPURIOUS_VEC));
   if (external) 
     {
       ASSERT (intr_get_level () == INTR_OFF);
       ASSERT (!intr_context ());
 
-      in_external_intr = true;
-      yield_on_return = false;
+      in_external_intr[cpu] = true;
+      yield_on_return[cpu] = false;
     }
 
   /* Invoke the interrupt's handler. */
   handler = intr_handlers[frame->vec_no];
+  if (external && (frame->eflags & FLAG_IF))
+    off_window_begin (handler);
   if (handler != NULL)
     handler (frame);
-  else if (frame->vec_no == 0x27 || frame->vec_no == 0x2f)
+  else if (frame->vec_no == 0x27 || frame->vec_no == 0x2f
+           || frame->vec_no == LAPIC_SPURIOUS_VEC)
     {
       /* There is no handler, but this interrupt can trigger
          spuriously due to a hardware fault or hardware race
@@ -374,18 +590,47 @@ intr_handler (struct intr_frame *frame)
   else
     unexpected_interrupt (frame);
 
+  cycles = timer_rdtsc () - start;
+  stat->cnt++;
+  stat->cycles += cycles;
+  if (cycles > stat->max_cycles)
+    stat->max_cycles = cycles;
+
   /* Complete the processing of an external interrupt. */
   if (external) 
     {
       ASSERT (intr_get_level () == INTR_OFF);
       ASSERT (intr_context ());
 
-      in_external_intr = false;
-      pic_end_of_interrupt (frame->vec_no); 
+      in_external_intr[cpu] = false;
+      if (frame->vec_no < 0x30)
+        pic_end_of_interrupt (frame->vec_no); 
+      else
+        lapic_eoi ();
 
-      if (yield_on_return) 
+      /* thread_yield() may move this thread to another CPU. */
+      if (yield_on_return[cpu]) 
         thread_yield (); 
+      if (frame->eflags & FLAG_IF)
+        off_window_end ();
+    }
+
+#ifdef USERPROG
+  /* A thread about to return to user mode in a process that is
+     exiting exits instead.  The status recorded when the process
+     was marked as exiting takes precedence over the one passed
+     here. */
+  if ((frame->cs & 3) == 3 && process_exiting ()) 
+    {
+      intr_enable ();
+      my_exit (-1);
     }
+#endif
+
+  /* If interrupts come back on when we return, give up the
+     kernel lock. */
+  if ((frame->eflags & FLAG_IF) && intr_get_level () == INTR_OFF)
+    kernel_unlock ();
 }
 
 /* Handles an unexpected interrupt with interrupt frame F.  An
@@ -430,6 +675,28 @@ intr_dump_frame (const struct intr_frame *f)
           f->cs, f->ds, f->es, f->ss);
 }
 
+/* Prints interrupt statistics: for each vector that has been
+   invoked, the number of invocations and the average and maximum
+   TSC cycles spent in its handler, followed by the longest time
+   interrupts have been kept off. */
+void
+intr_print_stats (void) 
+{
+  int vec;
+
+  for (vec = 0; vec < INTR_CNT; vec++) 
+    {
+      const struct intr_stat *stat = &intr_stats[vec];
+      if (stat->cnt > 0)
+        printf ("Interrupt %#04x (%s): %lld calls, %"PRIu64" cycles "
+                "average, %"PRIu64" max\n", vec, intr_names[vec],
+                stat->cnt, stat->cycles / stat->cnt, stat->max_cycles);
+    }
+  if (off_max > 0)
+    printf ("Interrupts: longest off for %"PRIu64" cycles, from %p\n",
+            off_max, off_max_where);
+}
+
 /* Returns the name of interrupt VEC. */
 const char *
 intr_name (uint8_t vec) 
@@ -6,15 +6,23 @@
 #include <stdio.h>
 #include <string.h>
 #include "threads/palloc.h"
+#include "threads/spinlock.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
 
 /* A simple implementation of malloc().
 
-   The size of each request, in bytes, is rounded up to a power
-   of 2 and assigned to the "descriptor" that manages blocks of
-   that size.  The descriptor keeps a list of free blocks.  If
-   the free list is nonempty, one of its blocks is used to
+   The size of each request, in bytes, is rounded up to the next
+   block size and assigned to the "descriptor" that manages
+   blocks of that size.  Block sizes go up in steps of 8 bytes
+   to 128 bytes, and above that in steps of a quarter of the
+   previous power of 2 (160, 192, 224, 256, 320, ...), so that
+   a block is at most 7 bytes or 25% bigger than the request it
+   serves, instead of the 100% that rounding up to a power of 2
+   allows.
+   A table indexed by size / 8 gives the descriptor for a size
+   without a search.  The descriptor keeps a list of free blocks.
+   If the free list is nonempty, one of its blocks is used to
    satisfy the request.
 
    Otherwise, a new page of memory, called an "arena", is
@@ -28,11 +36,17 @@
    blocks, we remove all of the arena's blocks from the free list
    and give the arena back to the page allocator.
 
-   We can't handle blocks bigger than 2 kB using this scheme,
-   because they're too big to fit in a single page with a
-   descriptor.  We handle those by allocating contiguous pages
-   with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   Block sizes stop at the largest that still fits twice in an
+   arena, because a bigger block would waste as much of its
+   page as a page of its own.  We handle bigger requests by
+   allocating contiguous pages with the page allocator and
+   sticking the allocation size at the beginning of the
+   allocated block's arena header.
+
+   realloc() keeps a block where it is if the new size has the
+   same descriptor, and shrinks a big block by giving its tail
+   pages back to the page allocator, copying only when the block
+   must grow past its size or can move to a smaller one. */
 
 /* Descriptor. */
 struct desc
@@ -61,27 +75,103 @@ struct block
   };
 
 /* Our set of descriptors. */
-static struct desc descs[10];   /* Descriptors. */
+static struct desc descs[32];   /* Descriptors. */
 static size_t desc_cnt;         /* Number of descriptors. */
 
+/* Granularity of block sizes and of the lookup table. */
+#define SIZE_STEP 8
+
+/* Size of the largest block that steps by SIZE_STEP. */
+#define FINE_MAX 128
+
+/* desc_of[DIV_ROUND_UP (SIZE, SIZE_STEP)] is the index in descs
+   of the descriptor for a SIZE-byte request, or desc_cnt if SIZE
+   is too big for any descriptor. */
+static uint8_t desc_of[PGSIZE / 2 / SIZE_STEP + 1];
+
+/* Pages held by the allocator, in arenas and big blocks. */
+static struct spinlock stats_lock;
+static size_t page_cnt_held;
+
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
+static void add_desc (size_t block_size);
+static struct desc *size_to_desc (size_t size);
+static void count_pages (long page_cnt);
 
 /* Initializes the malloc() descriptors. */
 void
 malloc_init (void) 
 {
-  size_t block_size;
-
-  for (block_size = 16; block_size < PGSIZE / 2; block_size *= 2)
+  size_t block_size, power, i;
+
+  for (block_size = sizeof (struct block); block_size <= FINE_MAX;
+       block_size += SIZE_STEP)
+    add_desc (block_size);
+  for (power = FINE_MAX; ; power *= 2)
+    for (block_size = power + power / 4; block_size <= power * 2;
+         block_size += power / 4)
+      {
+        if ((PGSIZE - sizeof (struct arena)) / block_size < 2)
+          goto done;
+        add_desc (block_size);
+      }
+ done:
+
+  /* Fill in the lookup table. */
+  for (i = 0; i < sizeof desc_of / sizeof *desc_of; i++) 
     {
-      struct desc *d = &descs[desc_cnt++];
-      ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
-      d->block_size = block_size;
-      d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
-      list_init (&d->free_list);
-      lock_init (&d->lock);
+      size_t d = 0;
+
+      while (d < desc_cnt && descs[d].block_size < i * SIZE_STEP)
+        d++;
+      desc_of[i] = d;
     }
+  spinlock_init (&stats_lock);
+}
+
+/* Adds a descriptor for blocks of BLOCK_SIZE bytes. */
+static void
+add_desc (size_t block_size) 
+{
+  struct desc *d = &descs[desc_cnt++];
+
+  ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
+  ASSERT (block_size % SIZE_STEP == 0);
+  d->block_size = block_size;
+  d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
+  list_init (&d->free_list);
+  lock_init (&d->lock);
+}
+
+/* Returns the descriptor for blocks big enough for SIZE bytes,
+   or a null pointer if SIZE is too big for any descriptor. */
+static struct desc *
+size_to_desc (size_t size) 
+{
+  size_t idx = DIV_ROUND_UP (size, SIZE_STEP);
+
+  if (idx >= sizeof desc_of / sizeof *desc_of || desc_of[idx] == desc_cnt)
+    return NULL;
+  return &descs[desc_of[idx]];
+}
+
+/* Returns the number of pages the allocator holds for arenas and
+   big blocks. */
+size_t
+malloc_page_cnt (void) 
+{
+  return page_cnt_held;
+}
+
+/* Adds PAGE_CNT, which may be negative, to the number of pages
+   held. */
+static void
+count_pages (long page_cnt) 
+{
+  spinlock_acquire (&stats_lock);
+  page_cnt_held += page_cnt;
+  spinlock_release (&stats_lock);
 }
 
 /* Obtains and returns a new block of at least SIZE bytes.
@@ -99,10 +189,8 @@ malloc (size_t size)
 
   /* Find the smallest descriptor that satisfies a SIZE-byte
      request. */
-  for (d = descs; d < descs + desc_cnt; d++)
-    if (d->block_size >= size)
-      break;
-  if (d == descs + desc_cnt) 
+  d = size_to_desc (size);
+  if (d == NULL) 
     {
       /* SIZE is too big for any descriptor.
          Allocate enough pages to hold SIZE plus an arena. */
@@ -110,6 +198,7 @@ malloc (size_t size)
       a = palloc_get_multiple (0, page_cnt);
       if (a == NULL)
         return NULL;
+      count_pages (page_cnt);
 
       /* Initialize the arena to indicate a big block of PAGE_CNT
          pages, and return it. */
@@ -133,6 +222,7 @@ malloc (size_t size)
           lock_release (&d->lock);
           return NULL; 
         }
+      count_pages (1);
 
       /* Initialize arena and add its blocks to the free list. */
       a->magic = ARENA_MAGIC;
@@ -185,6 +275,35 @@ block_size (void *block)
   return d != NULL ? d->block_size : PGSIZE * a->free_cnt - pg_ofs (block);
 }
 
+/* Attempts to resize OLD_BLOCK to NEW_SIZE bytes in place.
+   Returns true if successful, false if it must move. */
+static bool
+resize_in_place (void *old_block, size_t new_size) 
+{
+  struct arena *a = block_to_arena (old_block);
+  size_t page_cnt;
+
+  if (a->desc != NULL)
+    return size_to_desc (new_size) == a->desc;
+
+  /* A big block keeps the pages it still needs and gives the
+     rest back.  A block that no longer needs a page of its own
+     moves into an arena instead. */
+  if (size_to_desc (new_size) != NULL)
+    return false;
+  page_cnt = DIV_ROUND_UP (new_size + sizeof *a, PGSIZE);
+  if (page_cnt > a->free_cnt)
+    return false;
+  if (page_cnt < a->free_cnt) 
+    {
+      palloc_free_multiple ((uint8_t *) a + page_cnt * PGSIZE,
+                            a->free_cnt - page_cnt);
+      count_pages (-(long) (a->free_cnt - page_cnt));
+      a->free_cnt = page_cnt;
+    }
+  return true;
+}
+
 /* Attempts to resize OLD_BLOCK to NEW_SIZE bytes, possibly
    moving it in the process.
    If successful, returns the new block; on failure, returns a
@@ -199,6 +318,8 @@ realloc (void *old_block, size_t new_size)
       free (old_block);
       return NULL;
     }
+  else if (old_block != NULL && resize_in_place (old_block, new_size))
+    return old_block;
   else 
     {
       void *new_block = malloc (new_size);
@@ -250,6 +371,7 @@ free (void *p)
                   list_remove (&b->free_elem);
                 }
               palloc_free_page (a);
+              count_pages (-1);
             }
 
           lock_release (&d->lock);
@@ -257,6 +379,7 @@ free (void *p)
       else
         {
           /* It's a big block.  Free its pages. */
+          count_pages (-(long) a->free_cnt);
           palloc_free_multiple (a, a->free_cnt);
           return;
         }
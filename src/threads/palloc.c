@@ -2,46 +2,153 @@
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/loader.h"
-#include "threads/synch.h"
+#include "threads/spinlock.h"
 #include "threads/vaddr.h"
+#include "devices/timer.h"
 
 /* Page allocator.  Hands out memory in page-size (or
    page-multiple) chunks.  See malloc.h for an allocator that
    hands out smaller chunks.
 
-   System memory is divided into two "pools" called the kernel
-   and user pools.  The user pool is for user (virtual) memory
-   pages, the kernel pool for everything else.  The idea here is
+   All of free memory is a single pool of frames, which hands out
+   pages to two classes: user pages, for user (virtual) memory,
+   and kernel pages, for everything else.  Each class has a soft
+   limit, its share of the pool: by default half of memory for
+   each, with the user share capped by the "-ul" option.  A class
+   may use more than its share while the other class leaves pages
+   free, which we call borrowing, except that a borrower may not
+   take the last few free pages, which are kept for the lender.
+   Only a class that can give pages back may borrow, so user
+   pages may not until a reclaim function is registered for them,
+   while kernel pages always may: the kernel's own needs come
+   first.  When an allocation cannot be satisfied, the pool asks the
+   class that is over its share, and then the requesting class,
+   to give pages back through the reclaim function registered
+   with palloc_set_reclaim(), and tries again.  The idea is still
    that the kernel needs to have memory for its own operations
-   even if user processes are swapping like mad.
+   even if user processes are swapping like mad, but memory that
+   one side does not need is no longer wasted.  User pages are
+   also held to "-ul" as a hard limit.
 
-   By default, half of system RAM is given to the kernel pool and
-   half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   The pool is managed as a binary buddy system.  A free block
+   of order K is 2**K pages long and starts at a page index (from
+   the pool's base) that is a multiple of 2**K.  Its "buddy" is
+   the other half of the block of order K + 1 that contains it.
+   There is a free list per order, so a request is served from
+   the smallest free block that is big enough, splitting it in
+   halves as needed, and a freed block is merged with its buddy
+   for as long as the buddy is free too.  Both take time
+   proportional to the number of orders at worst, and a
+   single-page request that finds a free page takes constant
+   time.
+
+   A request for a number of pages that is not a power of 2 takes
+   a block of the next larger order and gives the pages past the
+   end back at once, so that a run of pages obtained together
+   may be freed in any pieces.  Free blocks are linked through
+   their first bytes.
+
+   The pool also keeps a cache of up to palloc_zero_watermark
+   single pages that are already zeroed, so that a PAL_ZERO page
+   request need not clear the page on the requester's time.  The
+   idle thread fills the cache, through palloc_zero_idle(), while
+   nothing else wants to run.  Freed pages are not cleared; they
+   go back to the buddy system, and are cleared only when the
+   idle thread takes them for the cache.  If the buddy system
+   runs out of memory, the cache is given back to it.  Cached
+   pages are free pages and belong to neither class. */
+
+/* Largest block order.  Pools are divided into blocks of at most
+   2**MAX_ORDER pages, so this also limits the size of a single
+   request. */
+#define MAX_ORDER 12
+
+/* Bit set in a pool's `orders' entry for the first page of each
+   free block, which also records the block's order. */
+#define FREE_HEAD 0x80
 
 /* A memory pool. */
 struct pool
   {
-    struct lock lock;                   /* Mutual exclusion. */
+    struct spinlock lock;               /* Mutual exclusion. */
     struct bitmap *used_map;            /* Bitmap of free pages. */
+    struct bitmap *user_map;            /* Bitmap of user pages. */
     uint8_t *base;                      /* Base of pool. */
+    size_t page_cnt;                    /* Number of pages. */
+    uint8_t *orders;                    /* Per page: FREE_HEAD | order
+                                           for a free block's first
+                                           page, otherwise 0. */
+    struct list free_lists[MAX_ORDER + 1]; /* Free blocks by order. */
+    size_t free_cnt;                    /* Number of free pages. */
+
+    /* Cache of zeroed pages. */
+    struct list zeroed;                 /* Zeroed free pages. */
+    size_t zeroed_cnt;                  /* Number of pages in zeroed. */
+    long long zero_hits;                /* PAL_ZERO pages from the cache. */
+    long long zero_misses;              /* PAL_ZERO pages cleared on demand. */
+    uint64_t miss_cycles;               /* TSC cycles spent on the latter. */
+    long long idle_zeroed;              /* Pages cleared by the idle thread. */
+    uint64_t idle_cycles;               /* TSC cycles spent on them. */
+  };
+
+/* Maximum number of zeroed pages kept in the pool's cache.
+   Controlled by kernel command-line option "-zp=PAGES". */
+size_t palloc_zero_watermark = 32;
+
+/* The pool of all free memory. */
+static struct pool frame_pool;
+
+/* A class of pages, kernel or user.  The counts are protected by
+   frame_pool's lock. */
+struct page_class
+  {
+    const char *name;                   /* "kernel" or "user". */
+    size_t used;                        /* Pages in use. */
+    size_t peak;                        /* Largest value of used. */
+    size_t soft_limit;                  /* Share of the pool. */
+    size_t hard_limit;                  /* Absolute maximum of used. */
+    palloc_reclaim_func *reclaim;       /* Gives pages back, or null. */
+    long long borrowed;                 /* Pages allocated over share. */
+    long long denied;                   /* Requests failed at a limit. */
+    long long reclaim_calls;            /* Calls to reclaim. */
+    long long reclaimed;                /* Pages it gave back. */
   };
 
-/* Two pools: one for kernel data, one for user pages. */
-static struct pool kernel_pool, user_pool;
+/* Page classes, indexed by page_class_of(). */
+#define CLASS_KERNEL 0
+#define CLASS_USER 1
+static struct page_class classes[2];
+
+/* A class over its share may not leave fewer than this many
+   pages free, so that the other class can still make progress
+   while it reclaims. */
+static size_t borrow_reserve;
 
 static void init_pool (struct pool *, void *base, size_t page_cnt,
                        const char *name);
+static void *class_alloc (struct pool *, struct page_class *,
+                          size_t page_cnt, enum palloc_flags, bool *cached);
+static bool class_may_borrow (const struct page_class *);
+static bool class_reclaim (struct page_class *, size_t page_cnt);
 static bool page_from_pool (const struct pool *, void *page);
+static size_t buddy_alloc (struct pool *, size_t page_cnt);
+static void buddy_free (struct pool *, size_t page_idx, size_t page_cnt);
+static void free_block (struct pool *, size_t page_idx, int order);
+static int largest_free_order (struct pool *);
+static void print_pool_stats (struct pool *, const char *name);
+static void print_class_stats (const struct page_class *);
+static void *zero_cache_get (struct pool *);
+static void zero_cache_drain (struct pool *);
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
-   pages are put into the user pool. */
+   pages are given to user pages. */
 void
 palloc_init (size_t user_page_limit)
 {
@@ -49,50 +156,83 @@ palloc_init (size_t user_page_limit)
   uint8_t *free_start = ptov (1024 * 1024);
   uint8_t *free_end = ptov (init_ram_pages * PGSIZE);
   size_t free_pages = (free_end - free_start) / PGSIZE;
-  size_t user_pages = free_pages / 2;
-  size_t kernel_pages;
-  if (user_pages > user_page_limit)
-    user_pages = user_page_limit;
-  kernel_pages = free_pages - user_pages;
+  size_t user_share;
+
+  init_pool (&frame_pool, free_start, free_pages, "frame pool");
 
-  /* Give half of memory to kernel, half to user. */
-  init_pool (&kernel_pool, free_start, kernel_pages, "kernel pool");
-  init_pool (&user_pool, free_start + kernel_pages * PGSIZE,
-             user_pages, "user pool");
+  /* Give each class half of memory as its share. */
+  user_share = frame_pool.page_cnt / 2;
+  if (user_share > user_page_limit)
+    user_share = user_page_limit;
+  classes[CLASS_KERNEL].name = "kernel";
+  classes[CLASS_KERNEL].soft_limit = frame_pool.page_cnt - user_share;
+  classes[CLASS_KERNEL].hard_limit = frame_pool.page_cnt;
+  classes[CLASS_USER].name = "user";
+  classes[CLASS_USER].soft_limit = user_share;
+  classes[CLASS_USER].hard_limit = user_page_limit;
+  borrow_reserve = frame_pool.page_cnt / 32;
+}
+
+/* Sets RECLAIM as the function that frees pages of the class
+   selected by FLAGS when the pool runs short: the user class if
+   PAL_USER is set, otherwise the kernel class. */
+void
+palloc_set_reclaim (enum palloc_flags flags, palloc_reclaim_func *reclaim)
+{
+  classes[flags & PAL_USER ? CLASS_USER : CLASS_KERNEL].reclaim = reclaim;
 }
 
 /* Obtains and returns a group of PAGE_CNT contiguous free pages.
-   If PAL_USER is set, the pages are obtained from the user pool,
-   otherwise from the kernel pool.  If PAL_ZERO is set in FLAGS,
+   If PAL_USER is set, the pages are user pages, otherwise
+   kernel pages.  If PAL_ZERO is set in FLAGS,
    then the pages are filled with zeros.  If too few pages are
    available, returns a null pointer, unless PAL_ASSERT is set in
    FLAGS, in which case the kernel panics. */
 void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
 {
-  struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+  struct pool *pool = &frame_pool;
+  struct page_class *class = &classes[flags & PAL_USER
+                                      ? CLASS_USER : CLASS_KERNEL];
+  struct page_class *other = &classes[flags & PAL_USER
+                                      ? CLASS_KERNEL : CLASS_USER];
   void *pages;
-  size_t page_idx;
+  bool cached;
 
   if (page_cnt == 0)
     return NULL;
 
-  lock_acquire (&pool->lock);
-  page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-  lock_release (&pool->lock);
+  /* Under pressure, ask the class over its share, then the
+     requesting class itself, to give pages back, and try again
+     after each. */
+  pages = class_alloc (pool, class, page_cnt, flags, &cached);
+  if (pages == NULL && other->used > other->soft_limit
+      && class_reclaim (other, page_cnt))
+    pages = class_alloc (pool, class, page_cnt, flags, &cached);
+  if (pages == NULL && class_reclaim (class, page_cnt))
+    pages = class_alloc (pool, class, page_cnt, flags, &cached);
 
-  if (page_idx != BITMAP_ERROR)
-    pages = pool->base + PGSIZE * page_idx;
-  else
-    pages = NULL;
-
-  if (pages != NULL) 
+  if (pages != NULL)
     {
-      if (flags & PAL_ZERO)
-        memset (pages, 0, PGSIZE * page_cnt);
+      if ((flags & PAL_ZERO) && !cached) 
+        {
+          uint64_t start = timer_rdtsc ();
+
+          memset (pages, 0, PGSIZE * page_cnt);
+          if (page_cnt == 1) 
+            {
+              spinlock_acquire (&pool->lock);
+              pool->zero_misses++;
+              pool->miss_cycles += timer_rdtsc () - start;
+              spinlock_release (&pool->lock);
+            }
+        }
     }
-  else 
+  else
     {
+      spinlock_acquire (&pool->lock);
+      class->denied++;
+      spinlock_release (&pool->lock);
       if (flags & PAL_ASSERT)
         PANIC ("palloc_get: out of pages");
     }
@@ -108,27 +248,23 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
    available, returns a null pointer, unless PAL_ASSERT is set in
    FLAGS, in which case the kernel panics. */
 void *
-palloc_get_page (enum palloc_flags flags) 
+palloc_get_page (enum palloc_flags flags)
 {
   return palloc_get_multiple (flags, 1);
 }
 
 /* Frees the PAGE_CNT pages starting at PAGES. */
 void
-palloc_free_multiple (void *pages, size_t page_cnt) 
+palloc_free_multiple (void *pages, size_t page_cnt)
 {
-  struct pool *pool;
-  size_t page_idx;
+  struct pool *pool = &frame_pool;
+  size_t page_idx, user_cnt;
 
   ASSERT (pg_ofs (pages) == 0);
   if (pages == NULL || page_cnt == 0)
     return;
 
-  if (page_from_pool (&kernel_pool, pages))
-    pool = &kernel_pool;
-  else if (page_from_pool (&user_pool, pages))
-    pool = &user_pool;
-  else
+  if (!page_from_pool (pool, pages))
     NOT_REACHED ();
 
   page_idx = pg_no (pages) - pg_no (pool->base);
@@ -137,46 +273,484 @@ palloc_free_multiple (void *pages, size_t page_cnt)
   memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
 
+  spinlock_acquire (&pool->lock);
   ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
-  bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+  user_cnt = bitmap_count (pool->user_map, page_idx, page_cnt, true);
+  bitmap_set_multiple (pool->user_map, page_idx, page_cnt, false);
+  classes[CLASS_USER].used -= user_cnt;
+  classes[CLASS_KERNEL].used -= page_cnt - user_cnt;
+  buddy_free (pool, page_idx, page_cnt);
+  spinlock_release (&pool->lock);
 }
 
 /* Frees the page at PAGE. */
 void
-palloc_free_page (void *page) 
+palloc_free_page (void *page)
 {
   palloc_free_multiple (page, 1);
 }
 
+/* Returns the number of pages in the largest free block in the
+   pool.  A request for that many pages or fewer will succeed,
+   unless it would take a class past a limit, at least until some
+   other request is made.  FLAGS is ignored, now that kernel and
+   user pages come from the same pool. */
+size_t
+palloc_largest_free (enum palloc_flags flags UNUSED)
+{
+  struct pool *pool = &frame_pool;
+  int order;
+
+  spinlock_acquire (&pool->lock);
+  order = largest_free_order (pool);
+  spinlock_release (&pool->lock);
+
+  return order >= 0 ? (size_t) 1 << order : 0;
+}
+
+/* Returns the share of the pool, in pages, of user pages if
+   PAL_USER is set in FLAGS, otherwise of kernel pages.  A class
+   that may borrow can use more than its share while the other
+   does not need it. */
+size_t
+palloc_share (enum palloc_flags flags)
+{
+  return classes[flags & PAL_USER ? CLASS_USER : CLASS_KERNEL].soft_limit;
+}
+
+/* Called by the idle thread, with interrupts on, while no other
+   thread is ready to run.  Clears a free page and adds it to the
+   pool's cache of zeroed pages, if the cache is below
+   palloc_zero_watermark.  Returns true if it did so, false if
+   there was nothing to do.  Never sleeps.
+
+   The pool's lock is a spin lock, not a struct lock, so that
+   the idle thread never holds a lock that another thread could
+   block on: a blocked thread would donate its priority to the
+   idle thread, which is never on a run queue. */
+bool
+palloc_zero_idle (void)
+{
+  struct pool *pool = &frame_pool;
+  size_t page_idx;
+  uint8_t *page;
+  uint64_t start;
+
+  spinlock_acquire (&pool->lock);
+  page_idx = (pool->zeroed_cnt < palloc_zero_watermark
+              ? buddy_alloc (pool, 1) : BITMAP_ERROR);
+  spinlock_release (&pool->lock);
+  if (page_idx == BITMAP_ERROR)
+    return false;
+
+  /* Clear the page with interrupts on, since nobody else can
+     see it meanwhile. */
+  page = pool->base + PGSIZE * page_idx;
+  start = timer_rdtsc ();
+  memset (page, 0, PGSIZE);
+
+  spinlock_acquire (&pool->lock);
+  pool->idle_cycles += timer_rdtsc () - start;
+  pool->idle_zeroed++;
+  list_push_front (&pool->zeroed, (struct list_elem *) page);
+  pool->zeroed_cnt++;
+  spinlock_release (&pool->lock);
+  return true;
+}
+
+/* Prints page allocator statistics. */
+void
+palloc_print_stats (void)
+{
+  print_pool_stats (&frame_pool, "frame");
+  print_class_stats (&classes[CLASS_KERNEL]);
+  print_class_stats (&classes[CLASS_USER]);
+}
+
+/* Prints statistics for POOL, named NAME.  The statistics are
+   copied out under the pool's lock, which is a spin lock, and
+   printed after it is released. */
+static void
+print_pool_stats (struct pool *pool, const char *name)
+{
+  size_t block_cnts[MAX_ORDER + 1];
+  size_t free_cnt, zeroed_cnt;
+  long long zero_hits, zero_misses, idle_zeroed;
+  uint64_t idle_cycles, miss_cycles;
+  int order;
+
+  spinlock_acquire (&pool->lock);
+  for (order = 0; order <= MAX_ORDER; order++)
+    block_cnts[order] = list_size (&pool->free_lists[order]);
+  free_cnt = pool->free_cnt;
+  zeroed_cnt = pool->zeroed_cnt;
+  zero_hits = pool->zero_hits;
+  zero_misses = pool->zero_misses;
+  miss_cycles = pool->miss_cycles;
+  idle_zeroed = pool->idle_zeroed;
+  idle_cycles = pool->idle_cycles;
+  spinlock_release (&pool->lock);
+
+  printf ("Palloc: %s pool: %zu of %zu pages free, in blocks of",
+          name, free_cnt, pool->page_cnt);
+  for (order = 0; order <= MAX_ORDER; order++)
+    if (block_cnts[order] > 0)
+      printf (" %zu*%d", block_cnts[order], 1 << order);
+  printf (" pages\n");
+  printf ("Palloc: %s pool: %lld of %lld zeroed-page requests served "
+          "pre-zeroed, %zu pages cached\n",
+          name, zero_hits, zero_hits + zero_misses, zeroed_cnt);
+  printf ("Palloc: %s pool: %lld pages zeroed while idle in %"PRIu64
+          " cycles, %lld on demand in %"PRIu64" cycles\n",
+          name, idle_zeroed, idle_cycles, zero_misses, miss_cycles);
+}
+
+/* Prints statistics for page class CLASS. */
+static void
+print_class_stats (const struct page_class *class)
+{
+  struct page_class c;
+
+  spinlock_acquire (&frame_pool.lock);
+  c = *class;
+  spinlock_release (&frame_pool.lock);
+
+  printf ("Palloc: %s pages: %zu in use, %zu at peak, share %zu; "
+          "%lld pages borrowed, %lld requests denied\n",
+          c.name, c.used, c.peak, c.soft_limit, c.borrowed, c.denied);
+  printf ("Palloc: %s pages: %lld reclaim calls gave back %lld pages\n",
+          c.name, c.reclaim_calls, c.reclaimed);
+}
+
 /* Initializes pool P as starting at START and ending at END,
    naming it NAME for debugging purposes. */
 static void
-init_pool (struct pool *p, void *base, size_t page_cnt, const char *name) 
+init_pool (struct pool *p, void *base, size_t page_cnt, const char *name)
 {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
-     and subtract it from the pool's size. */
-  size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (page_cnt), PGSIZE);
+  /* We'll put the pool's used_map, user_map, and orders at its
+     base.  Calculate the space needed for them and subtract it
+     from the pool's size. */
+  size_t bm_pages = DIV_ROUND_UP (2 * bitmap_buf_size (page_cnt) + page_cnt,
+                                  PGSIZE);
+  size_t bm_size;
+  int order;
+
   if (bm_pages > page_cnt)
     PANIC ("Not enough memory in %s for bitmap.", name);
   page_cnt -= bm_pages;
+  bm_size = bitmap_buf_size (page_cnt);
 
   printf ("%zu pages available in %s.\n", page_cnt, name);
 
   /* Initialize the pool. */
-  lock_init (&p->lock);
-  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
+  spinlock_init (&p->lock);
+  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_size);
+  p->user_map = bitmap_create_in_buf (page_cnt, (uint8_t *) base + bm_size,
+                                      bm_size);
+  p->orders = (uint8_t *) base + 2 * bm_size;
+  memset (p->orders, 0, page_cnt);
   p->base = base + bm_pages * PGSIZE;
+  p->page_cnt = page_cnt;
+  for (order = 0; order <= MAX_ORDER; order++)
+    list_init (&p->free_lists[order]);
+  p->free_cnt = 0;
+  list_init (&p->zeroed);
+
+  /* Every page starts out in use; freeing them all divides the
+     pool into the largest blocks that fit. */
+  bitmap_set_all (p->used_map, true);
+  spinlock_acquire (&p->lock);
+  buddy_free (p, 0, page_cnt);
+  spinlock_release (&p->lock);
 }
 
 /* Returns true if PAGE was allocated from POOL,
    false otherwise. */
 static bool
-page_from_pool (const struct pool *pool, void *page) 
+page_from_pool (const struct pool *pool, void *page)
 {
   size_t page_no = pg_no (page);
   size_t start_page = pg_no (pool->base);
-  size_t end_page = start_page + bitmap_size (pool->used_map);
+  size_t end_page = start_page + pool->page_cnt;
 
   return page_no >= start_page && page_no < end_page;
 }
+
+/* Returns the first page of free block E. */
+static inline uint8_t *
+block_page (struct list_elem *e)
+{
+  return (uint8_t *) e;
+}
+
+/* Returns the index within POOL of the page at PAGE. */
+static inline size_t
+page_index (const struct pool *pool, const void *page)
+{
+  return ((const uint8_t *) page - pool->base) / PGSIZE;
+}
+
+/* Returns the free-list element of the block whose first page
+   is PAGE_IDX within POOL. */
+static inline struct list_elem *
+block_elem (const struct pool *pool, size_t page_idx)
+{
+  return (struct list_elem *) (pool->base + page_idx * PGSIZE);
+}
+
+/* Returns the smallest order whose blocks hold PAGE_CNT pages. */
+static int
+order_for (size_t page_cnt)
+{
+  int order = 0;
+
+  while (((size_t) 1 << order) < page_cnt)
+    order++;
+  return order;
+}
+
+/* Allocates PAGE_CNT contiguous pages from POOL and returns the
+   index of the first, or BITMAP_ERROR if no free block is big
+   enough.  POOL's lock must be held. */
+static size_t
+buddy_alloc (struct pool *pool, size_t page_cnt)
+{
+  int order = order_for (page_cnt);
+  int k;
+  size_t page_idx;
+
+  ASSERT (spinlock_held (&pool->lock));
+
+  if (order > MAX_ORDER)
+    return BITMAP_ERROR;
+
+  /* Take the smallest free block that is big enough. */
+  for (k = order; k <= MAX_ORDER; k++)
+    if (!list_empty (&pool->free_lists[k]))
+      break;
+  if (k > MAX_ORDER)
+    return BITMAP_ERROR;
+  page_idx = page_index (pool,
+                         block_page (list_pop_front (&pool->free_lists[k])));
+  pool->orders[page_idx] = 0;
+  pool->free_cnt -= (size_t) 1 << k;
+
+  /* Split it, freeing the upper halves, until it is the size we
+     want. */
+  while (k > order)
+    {
+      size_t half;
+
+      k--;
+      half = page_idx + ((size_t) 1 << k);
+      pool->orders[half] = FREE_HEAD | k;
+      list_push_front (&pool->free_lists[k], block_elem (pool, half));
+      pool->free_cnt += (size_t) 1 << k;
+    }
+
+  ASSERT (bitmap_none (pool->used_map, page_idx, (size_t) 1 << order));
+  bitmap_set_multiple (pool->used_map, page_idx, (size_t) 1 << order, true);
+
+  /* Give back the pages past the end of the request. */
+  if (page_cnt < (size_t) 1 << order)
+    buddy_free (pool, page_idx + page_cnt,
+                ((size_t) 1 << order) - page_cnt);
+  return page_idx;
+}
+
+/* Frees the PAGE_CNT pages starting at index PAGE_IDX within
+   POOL, which need not be a single block, by freeing the largest
+   aligned blocks that make them up.  POOL's lock must be
+   held. */
+static void
+buddy_free (struct pool *pool, size_t page_idx, size_t page_cnt)
+{
+  ASSERT (spinlock_held (&pool->lock));
+  ASSERT (page_idx + page_cnt <= pool->page_cnt);
+
+  bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+  while (page_cnt > 0)
+    {
+      int order = 0;
+
+      while (order < MAX_ORDER
+             && page_idx % ((size_t) 2 << order) == 0
+             && ((size_t) 2 << order) <= page_cnt)
+        order++;
+      free_block (pool, page_idx, order);
+      page_idx += (size_t) 1 << order;
+      page_cnt -= (size_t) 1 << order;
+    }
+}
+
+/* Puts the block of order ORDER whose first page is PAGE_IDX
+   within POOL on a free list, after merging it with its buddy,
+   and the resulting block with its buddy, and so on, for as long
+   as the buddy is free. */
+static void
+free_block (struct pool *pool, size_t page_idx, int order)
+{
+  pool->free_cnt += (size_t) 1 << order;
+  while (order < MAX_ORDER)
+    {
+      size_t buddy = page_idx ^ ((size_t) 1 << order);
+
+      if (buddy + ((size_t) 1 << order) > pool->page_cnt
+          || pool->orders[buddy] != (FREE_HEAD | order))
+        break;
+      list_remove (block_elem (pool, buddy));
+      pool->orders[buddy] = 0;
+      if (buddy < page_idx)
+        page_idx = buddy;
+      order++;
+    }
+  pool->orders[page_idx] = FREE_HEAD | order;
+  list_push_front (&pool->free_lists[order], block_elem (pool, page_idx));
+}
+
+/* Returns the order of the largest free block in POOL, or -1 if
+   POOL has no free pages. */
+static int
+largest_free_order (struct pool *pool)
+{
+  int order;
+
+  for (order = MAX_ORDER; order >= 0; order--)
+    if (!list_empty (&pool->free_lists[order]))
+      return order;
+  return -1;
+}
+
+/* Allocates PAGE_CNT contiguous pages of class CLASS from POOL
+   and returns the first, or a null pointer if the pool has no
+   free block big enough or CLASS may not have that many more
+   pages.  A single page requested with PAL_ZERO in FLAGS comes
+   from the cache of zeroed pages if possible, in which case
+   *CACHED is set to true, otherwise to false. */
+static void *
+class_alloc (struct pool *pool, struct page_class *class,
+             size_t page_cnt, enum palloc_flags flags, bool *cached)
+{
+  uint8_t *pages = NULL;
+  size_t page_idx = BITMAP_ERROR;
+  size_t new_used;
+
+  *cached = false;
+  spinlock_acquire (&pool->lock);
+  new_used = class->used + page_cnt;
+
+  /* Past its share, a class may only borrow pages that leave
+     borrow_reserve free, and only if it may borrow at all. */
+  if (new_used > class->hard_limit
+      || (new_used > class->soft_limit
+          && (!class_may_borrow (class)
+              || (pool->free_cnt + pool->zeroed_cnt
+                  < page_cnt + borrow_reserve))))
+    goto done;
+
+  if (page_cnt == 1 && (flags & PAL_ZERO)) 
+    {
+      pages = zero_cache_get (pool);
+      if (pages != NULL) 
+        {
+          page_idx = page_index (pool, pages);
+          *cached = true;
+        }
+    }
+  if (page_idx == BITMAP_ERROR) 
+    {
+      page_idx = buddy_alloc (pool, page_cnt);
+      if (page_idx == BITMAP_ERROR && pool->zeroed_cnt > 0) 
+        {
+          zero_cache_drain (pool);
+          page_idx = buddy_alloc (pool, page_cnt);
+        }
+      if (page_idx == BITMAP_ERROR)
+        goto done;
+      pages = pool->base + PGSIZE * page_idx;
+    }
+
+  if (class == &classes[CLASS_USER])
+    bitmap_set_multiple (pool->user_map, page_idx, page_cnt, true);
+  if (new_used > class->soft_limit)
+    class->borrowed += (new_used - class->soft_limit < page_cnt
+                        ? new_used - class->soft_limit : page_cnt);
+  class->used = new_used;
+  if (new_used > class->peak)
+    class->peak = new_used;
+
+ done:
+  spinlock_release (&pool->lock);
+  return pages;
+}
+
+/* Returns true if CLASS may use more than its share.  Pages lent
+   to user memory would never come back without a reclaim
+   function to evict them, leaving the kernel short for as long
+   as the process lives, so user pages may borrow only once one
+   is registered.  The kernel may always borrow. */
+static bool
+class_may_borrow (const struct page_class *class)
+{
+  return class == &classes[CLASS_KERNEL] || class->reclaim != NULL;
+}
+
+/* Asks CLASS's reclaim function, if it has one, to give back at
+   least PAGE_CNT pages.  Returns true if it gave back any.  Must
+   be called without the pool's lock, since the reclaim function
+   frees pages. */
+static bool
+class_reclaim (struct page_class *class, size_t page_cnt)
+{
+  size_t freed;
+
+  if (class->reclaim == NULL)
+    return false;
+  freed = class->reclaim (page_cnt);
+
+  spinlock_acquire (&frame_pool.lock);
+  class->reclaim_calls++;
+  class->reclaimed += freed;
+  spinlock_release (&frame_pool.lock);
+  return freed > 0;
+}
+
+/* Removes and returns a page from POOL's cache of zeroed pages,
+   or returns a null pointer if the cache is empty.  The page
+   still has the zeros it was cached with, except for the list
+   element at its start, which is cleared here.  POOL's lock
+   must be held. */
+static void *
+zero_cache_get (struct pool *pool)
+{
+  struct list_elem *e = NULL;
+
+  ASSERT (spinlock_held (&pool->lock));
+
+  if (!list_empty (&pool->zeroed)) 
+    {
+      e = list_pop_front (&pool->zeroed);
+      pool->zeroed_cnt--;
+      pool->zero_hits++;
+    }
+
+  if (e != NULL)
+    memset (e, 0, sizeof *e);
+  return e;
+}
+
+/* Gives all the pages in POOL's cache of zeroed pages back to
+   its buddy system.  POOL's lock must be held. */
+static void
+zero_cache_drain (struct pool *pool)
+{
+  ASSERT (spinlock_held (&pool->lock));
+
+  while (!list_empty (&pool->zeroed)) 
+    {
+      struct list_elem *e = list_pop_front (&pool->zeroed);
+
+      pool->zeroed_cnt--;
+      buddy_free (pool, page_index (pool, e), 1);
+    }
+}
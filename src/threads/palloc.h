@@ -1,6 +1,7 @@
 #ifndef THREADS_PALLOC_H
 #define THREADS_PALLOC_H
 
+#include <stdbool.h>
 #include <stddef.h>
 
 /* How to allocate pages. */
@@ -11,10 +12,23 @@ enum palloc_flags
     PAL_USER = 004              /* User page. */
   };
 
+/* Maximum number of pre-zeroed pages kept in the pool. */
+extern size_t palloc_zero_watermark;
+
+/* Frees at least PAGE_CNT pages of one class, if it can, when
+   the page pool runs short.  Returns the number of pages freed.
+   Called without any allocator lock held. */
+typedef size_t palloc_reclaim_func (size_t page_cnt);
+
 void palloc_init (size_t user_page_limit);
+void palloc_set_reclaim (enum palloc_flags, palloc_reclaim_func *);
 void *palloc_get_page (enum palloc_flags);
 void *palloc_get_multiple (enum palloc_flags, size_t page_cnt);
 void palloc_free_page (void *);
 void palloc_free_multiple (void *, size_t page_cnt);
+size_t palloc_largest_free (enum palloc_flags);
+size_t palloc_share (enum palloc_flags);
+bool palloc_zero_idle (void);
+void palloc_print_stats (void);
 
 #endif /* threads/palloc.h */
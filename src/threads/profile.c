@@ -0,0 +1,95 @@
+#include "threads/profile.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+
+/* Sampling is off by default. */
+bool profile_enabled;
+
+/* One row of the histogram: the number of samples taken at one
+   address while one thread was running. */
+struct profile_slot 
+  {
+    uintptr_t eip;              /* Interrupted instruction address. */
+    tid_t tid;                  /* Running thread. */
+    bool user;                  /* Interrupted in user mode? */
+    unsigned cnt;               /* # of samples; 0 if slot is free. */
+    char name[16];              /* Name of running thread. */
+  };
+
+/* Histogram, an open-addressed hash table of PROFILE_SLOTS rows
+   keyed on address and thread.  Samples that find it full are
+   only counted as dropped. */
+#define PROFILE_BITS 10
+#define PROFILE_SLOTS (1 << PROFILE_BITS)
+static struct profile_slot slots[PROFILE_SLOTS];
+
+static long long kernel_samples;  /* # of samples in the kernel. */
+static long long user_samples;    /* # of samples in user programs. */
+static long long dropped_samples; /* # of samples with no free row. */
+
+/* Records a sample of the code interrupted by F.  Called by the
+   timer interrupt handler, with interrupts off. */
+void
+profile_sample (const struct intr_frame *f) 
+{
+  struct thread *t = thread_current ();
+  uintptr_t eip = (uintptr_t) f->eip;
+  bool user = (f->cs & 3) != 0;
+  unsigned i, probes;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (user)
+    user_samples++;
+  else
+    kernel_samples++;
+
+  i = (eip ^ ((unsigned) t->tid * 0x9e3779b1u)) & (PROFILE_SLOTS - 1);
+  for (probes = 0; probes < PROFILE_SLOTS; probes++)
+    {
+      struct profile_slot *s = &slots[i];
+
+      if (s->cnt == 0) 
+        {
+          s->eip = eip;
+          s->tid = t->tid;
+          s->user = user;
+          strlcpy (s->name, t->name, sizeof s->name);
+        }
+      if (s->eip == eip && s->tid == t->tid && s->user == user) 
+        {
+          s->cnt++;
+          return;
+        }
+      i = (i + 1) & (PROFILE_SLOTS - 1);
+    }
+  dropped_samples++;
+}
+
+/* Prints the histogram, one line per row that has samples:
+   "Profile: kernel|user ADDRESS COUNT THREAD TID". */
+void
+profile_print (void) 
+{
+  int i;
+
+  if (!profile_enabled)
+    return;
+
+  printf ("Profile: %lld samples, %lld kernel, %lld user, %lld dropped\n",
+          kernel_samples + user_samples, kernel_samples, user_samples,
+          dropped_samples);
+  for (i = 0; i < PROFILE_SLOTS; i++) 
+    {
+      const struct profile_slot *s = &slots[i];
+      if (s->cnt > 0)
+        printf ("Profile: %s %#010"PRIxPTR" %u %s %d\n",
+                s->user ? "user" : "kernel", s->eip, s->cnt,
+                s->name, s->tid);
+    }
+}
@@ -0,0 +1,24 @@
+#ifndef THREADS_PROFILE_H
+#define THREADS_PROFILE_H
+
+#include <stdbool.h>
+
+/* Sampling CPU profiler.
+
+   When enabled, the timer interrupt handler passes each
+   interrupted frame to profile_sample(), which counts the
+   interrupted instruction address, tagged with the running
+   thread and with whether it was in the kernel or in a user
+   program, in a fixed-size table.  profile_print() dumps the
+   table at power-off, one "Profile:" line per address and
+   thread, in a form that "backtrace --profile" turns into flat
+   and per-function profiles.
+
+   Controlled by kernel command-line option "-o profile". */
+extern bool profile_enabled;
+
+struct intr_frame;
+void profile_sample (const struct intr_frame *);
+void profile_print (void);
+
+#endif /* threads/profile.h */
@@ -0,0 +1,310 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Slab allocator for kernel objects of a single type.
+
+   malloc() rounds each request up to one of its block sizes,
+   which may waste up to a quarter of the block, and shares each
+   block size among all the types that round up to it.  A
+   "cache" made by kmem_cache_create() instead hands out objects
+   of one exact size, rounded up only to a word, from "slabs" of
+   one page each, and keeps statistics for that type alone.
+
+   A slab starts with a struct slab header, followed by an array
+   of free-object indexes, and then the objects themselves.  The
+   free objects of a slab form a stack of indexes in that array,
+   rather than a list threaded through the objects, so that the
+   objects keep their contents while they are free.  This is
+   what makes constructors useful: a cache's constructor, if it
+   has one, runs once for each object when its slab is created,
+   not on every allocation, and an object must be freed in its
+   constructed state.
+
+   Slabs with both free and used objects are on the cache's
+   partial list, which allocation draws from, and full slabs are
+   on its full list.  A slab whose last object is freed is kept
+   as the cache's spare, so that an object allocated and freed
+   over and over does not make a page go back and forth to the
+   page allocator; a second empty slab is freed.
+
+   The space left over at the end of a slab is used to "color"
+   slabs: each new slab starts its objects SLAB_COLOR bytes
+   further along than the previous one, wrapping around when the
+   leftover space runs out, so that objects at the same index in
+   different slabs do not all map to the same cache lines. */
+
+/* Distance between slab colors, in bytes. */
+#define SLAB_COLOR 32
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* A cache of objects of one type. */
+struct kmem_cache
+  {
+    char name[16];              /* Name, for statistics. */
+    size_t obj_size;            /* Size of each object in bytes. */
+    size_t req_size;            /* Size requested by the creator. */
+    kmem_ctor_func *ctor;       /* Constructor, or null. */
+    size_t objs_per_slab;       /* Number of objects in a slab. */
+    size_t first_ofs;           /* Offset of first object, uncolored. */
+    size_t color_cnt;           /* Number of different colors. */
+    size_t next_color;          /* Color of the next slab. */
+    struct list_elem elem;      /* Element in cache_list. */
+
+    struct lock lock;           /* Protects the members below. */
+    struct list partial;        /* Slabs with free and used objects. */
+    struct list full;           /* Slabs with no free objects. */
+    struct slab *spare;         /* Empty slab, or null. */
+    size_t slab_cnt;            /* Number of slabs, including spare. */
+    size_t in_use;              /* Number of objects allocated. */
+    size_t peak;                /* Largest value of in_use. */
+    long long alloc_cnt;        /* Number of calls to allocate. */
+  };
+
+/* Header at the start of each slab. */
+struct slab
+  {
+    unsigned magic;             /* Always set to SLAB_MAGIC. */
+    struct kmem_cache *cache;   /* Owning cache. */
+    struct list_elem elem;      /* Element in partial or full list. */
+    uint8_t *objs;              /* First object. */
+    size_t free_cnt;            /* Number of free objects. */
+    uint16_t free[];            /* Indexes of free objects. */
+  };
+
+/* All caches, for statistics. */
+static struct list cache_list = LIST_INITIALIZER (cache_list);
+static struct lock cache_list_lock;
+static bool cache_list_ready;
+
+static struct slab *slab_create (struct kmem_cache *);
+static struct slab *obj_to_slab (struct kmem_cache *, void *);
+
+/* Creates and returns a cache of objects of SIZE bytes, named
+   NAME for statistics.  If CTOR is nonnull, it is called on each
+   object when its slab is created.  Panics if SIZE is too big
+   for a slab to hold at least one object, or if memory is not
+   available. */
+struct kmem_cache *
+kmem_cache_create (const char *name, size_t size, kmem_ctor_func *ctor)
+{
+  struct kmem_cache *c;
+  size_t obj_size = ROUND_UP (size > 0 ? size : 1, sizeof (void *));
+  size_t leftover;
+
+  c = malloc (sizeof *c);
+  if (c == NULL)
+    PANIC ("kmem_cache_create: out of memory");
+  strlcpy (c->name, name, sizeof c->name);
+  c->obj_size = obj_size;
+  c->req_size = size;
+  c->ctor = ctor;
+
+  /* Fit as many objects, with their free-index entries, as the
+     page holds after the header. */
+  c->objs_per_slab = ((PGSIZE - sizeof (struct slab))
+                      / (obj_size + sizeof (uint16_t)));
+  if (c->objs_per_slab == 0)
+    PANIC ("kmem_cache_create: %zu-byte objects are too big for a slab",
+           size);
+  c->first_ofs = ROUND_UP (sizeof (struct slab)
+                           + c->objs_per_slab * sizeof (uint16_t),
+                           sizeof (void *));
+  while (c->first_ofs + c->objs_per_slab * obj_size > PGSIZE)
+    c->objs_per_slab--;
+  leftover = PGSIZE - c->first_ofs - c->objs_per_slab * obj_size;
+  c->color_cnt = leftover / SLAB_COLOR + 1;
+  c->next_color = 0;
+
+  lock_init (&c->lock);
+  list_init (&c->partial);
+  list_init (&c->full);
+  c->spare = NULL;
+  c->slab_cnt = 0;
+  c->in_use = 0;
+  c->peak = 0;
+  c->alloc_cnt = 0;
+
+  if (!cache_list_ready) 
+    {
+      lock_init (&cache_list_lock);
+      cache_list_ready = true;
+    }
+  lock_acquire (&cache_list_lock);
+  list_push_back (&cache_list, &c->elem);
+  lock_release (&cache_list_lock);
+
+  return c;
+}
+
+/* Allocates and returns an object from cache C, or a null
+   pointer if memory is not available. */
+void *
+kmem_cache_alloc (struct kmem_cache *c) 
+{
+  struct slab *s;
+  void *obj;
+
+  lock_acquire (&c->lock);
+  c->alloc_cnt++;
+  if (!list_empty (&c->partial))
+    s = list_entry (list_front (&c->partial), struct slab, elem);
+  else 
+    {
+      if (c->spare != NULL) 
+        {
+          s = c->spare;
+          c->spare = NULL;
+        }
+      else 
+        {
+          s = slab_create (c);
+          if (s == NULL) 
+            {
+              lock_release (&c->lock);
+              return NULL;
+            }
+        }
+      list_push_front (&c->partial, &s->elem);
+    }
+
+  obj = s->objs + s->free[--s->free_cnt] * c->obj_size;
+  if (s->free_cnt == 0) 
+    {
+      list_remove (&s->elem);
+      list_push_front (&c->full, &s->elem);
+    }
+  if (++c->in_use > c->peak)
+    c->peak = c->in_use;
+  lock_release (&c->lock);
+
+  return obj;
+}
+
+/* Frees OBJ, which must have been allocated from cache C and, if
+   C has a constructor, must be in its constructed state. */
+void
+kmem_cache_free (struct kmem_cache *c, void *obj) 
+{
+  struct slab *s;
+  struct slab *empty = NULL;
+
+  if (obj == NULL)
+    return;
+
+  s = obj_to_slab (c, obj);
+  lock_acquire (&c->lock);
+  ASSERT (s->free_cnt < c->objs_per_slab);
+  if (s->free_cnt == 0) 
+    {
+      /* Full slab becomes partial. */
+      list_remove (&s->elem);
+      list_push_front (&c->partial, &s->elem);
+    }
+  s->free[s->free_cnt++] = ((uint8_t *) obj - s->objs) / c->obj_size;
+  c->in_use--;
+
+  if (s->free_cnt == c->objs_per_slab) 
+    {
+      /* Empty slab becomes the spare, or is freed. */
+      list_remove (&s->elem);
+      if (c->spare == NULL)
+        c->spare = s;
+      else 
+        {
+          empty = s;
+          c->slab_cnt--;
+        }
+    }
+  lock_release (&c->lock);
+
+  if (empty != NULL)
+    palloc_free_page (empty);
+}
+
+/* Prints occupancy statistics for every cache. */
+void
+kmem_print_stats (void) 
+{
+  struct list_elem *e;
+
+  if (!cache_list_ready)
+    return;
+
+  lock_acquire (&cache_list_lock);
+  for (e = list_begin (&cache_list); e != list_end (&cache_list);
+       e = list_next (e)) 
+    {
+      struct kmem_cache *c = list_entry (e, struct kmem_cache, elem);
+      size_t capacity;
+
+      lock_acquire (&c->lock);
+      capacity = c->slab_cnt * c->objs_per_slab;
+      printf ("Slab: %s: %zu of %zu objects in use (%zu%%), %zu at peak, "
+              "%zu slabs, %zu bytes each (%zu requested), %lld allocs\n",
+              c->name, c->in_use, capacity,
+              capacity > 0 ? c->in_use * 100 / capacity : 0,
+              c->peak, c->slab_cnt, c->obj_size, c->req_size,
+              c->alloc_cnt);
+      lock_release (&c->lock);
+    }
+  lock_release (&cache_list_lock);
+}
+
+/* Obtains a page for a new slab of cache C, constructs all of
+   its objects, and returns it, or returns a null pointer if no
+   page is available.  C's lock must be held. */
+static struct slab *
+slab_create (struct kmem_cache *c) 
+{
+  struct slab *s = palloc_get_page (0);
+  size_t i;
+
+  if (s == NULL)
+    return NULL;
+
+  s->magic = SLAB_MAGIC;
+  s->cache = c;
+  s->objs = (uint8_t *) s + c->first_ofs + c->next_color * SLAB_COLOR;
+  c->next_color = (c->next_color + 1) % c->color_cnt;
+
+  /* Push the indexes in reverse, so that objects are handed out
+     in address order. */
+  s->free_cnt = c->objs_per_slab;
+  for (i = 0; i < c->objs_per_slab; i++) 
+    {
+      s->free[i] = c->objs_per_slab - 1 - i;
+      if (c->ctor != NULL)
+        c->ctor (s->objs + i * c->obj_size);
+    }
+  c->slab_cnt++;
+  return s;
+}
+
+/* Returns the slab that OBJ, an object of cache C, is inside. */
+static struct slab *
+obj_to_slab (struct kmem_cache *c, void *obj) 
+{
+  struct slab *s = pg_round_down (obj);
+
+  /* Check that the slab is valid and belongs to C. */
+  ASSERT (s->magic == SLAB_MAGIC);
+  ASSERT (s->cache == c);
+
+  /* Check that the object is properly aligned for the slab. */
+  ASSERT ((uint8_t *) obj >= s->objs);
+  ASSERT (((uint8_t *) obj - s->objs) % c->obj_size == 0);
+  ASSERT (((uint8_t *) obj - s->objs) / c->obj_size < c->objs_per_slab);
+
+  return s;
+}
@@ -0,0 +1,314 @@
+#include "threads/smp.h"
+#include <debug.h>
+#include <packed.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/lapic.h"
+#include "devices/timer.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/loader.h"
+#include "threads/palloc.h"
+#include "threads/pte.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Multiprocessor startup.
+
+   smp_init() reads the tables that the BIOS leaves in memory
+   according to the MultiProcessor Specification [MP], to find
+   out how many CPUs there are and the IDs of their local APICs.
+   smp_start() then starts the application processors (APs), that
+   is, every CPU but the boot CPU, one at a time.  It copies the
+   code in ap-start.S to AP_START and sends the AP the INIT and
+   start-up interrupts.  The AP switches to protected mode and
+   paging and calls ap_main() on the stack of an idle thread that
+   the boot CPU made for it, and from then on it schedules
+   threads like the boot CPU, from its own run queue.
+
+   Only the boot CPU receives device interrupts and runs user
+   code; see lapic.c and thread_pin().  The CPUs' time stamp
+   counters are taken to be in step, as they are under QEMU. */
+
+/* Physical address of the AP startup code.  Memory below 1 MB
+   is not given out by the page allocator, and nothing else uses
+   this page once the loader is done. */
+#define AP_START 0x8000
+
+/* Milliseconds to wait for an AP to start. */
+#define AP_START_TIMEOUT 100
+
+/* MP floating pointer structure.  See [MP] 4.1. */
+struct mp_fp
+  {
+    char signature[4];          /* "_MP_". */
+    uint32_t config;            /* Physical address of mp_config. */
+    uint8_t length;             /* Length in 16-byte units. */
+    uint8_t spec_rev;           /* Specification revision. */
+    uint8_t checksum;           /* Makes the bytes sum to 0. */
+    uint8_t type;               /* Default configuration, or 0. */
+    uint8_t features[4];        /* Feature bytes. */
+  }
+PACKED;
+
+/* MP configuration table header.  See [MP] 4.2. */
+struct mp_config
+  {
+    char signature[4];          /* "PCMP". */
+    uint16_t length;            /* Base table length, with header. */
+    uint8_t spec_rev;           /* Specification revision. */
+    uint8_t checksum;           /* Makes the base table sum to 0. */
+    char oem_id[8];             /* Manufacturer. */
+    char product_id[12];        /* Product family. */
+    uint32_t oem_table;         /* Physical address of OEM table. */
+    uint16_t oem_table_size;    /* Size of OEM table. */
+    uint16_t entry_cnt;         /* Number of entries after header. */
+    uint32_t lapic;             /* Physical address of local APICs. */
+    uint16_t ext_length;        /* Extended table length. */
+    uint8_t ext_checksum;       /* Extended table checksum. */
+    uint8_t reserved;
+  }
+PACKED;
+
+/* MP configuration table processor entry.  See [MP] 4.3.1.
+   Entries of the other types are 8 bytes long. */
+struct mp_processor
+  {
+    uint8_t type;               /* MP_PROCESSOR. */
+    uint8_t apic_id;            /* Local APIC ID. */
+    uint8_t apic_version;       /* Local APIC version. */
+    uint8_t flags;              /* MP_ENABLED, MP_BSP. */
+    uint32_t signature;         /* CPU stepping, model, family. */
+    uint32_t features;          /* CPUID feature flags. */
+    uint32_t reserved[2];
+  }
+PACKED;
+
+#define MP_PROCESSOR 0          /* Processor entry type. */
+#define MP_LINTR 4              /* Last known entry type. */
+#define MP_ENABLED 0x01         /* Processor is usable. */
+#define MP_BSP 0x02             /* Processor is the boot CPU. */
+
+/* CPUs found by smp_init().  Index 0 is the boot CPU. */
+static uint8_t apic_ids[CPU_MAX];       /* Local APIC IDs. */
+static unsigned cpu_found;              /* Number of CPUs. */
+static uintptr_t lapic_paddr;           /* Local APIC registers. */
+
+/* Handshake with the AP being started.  ap-start.S loads the
+   stack pointer from ap_stack, and the AP sets ap_started once
+   it is scheduling threads. */
+void *ap_stack;
+static volatile bool ap_started;
+
+/* Defined in ap-start.S. */
+extern char ap_start[], ap_start_end[], ap_gdt[], ap_gdt_base[], ap_cr3[];
+
+void ap_main (void) NO_RETURN;
+static struct mp_fp *mp_search (void);
+static struct mp_fp *mp_search_range (uintptr_t paddr, size_t size);
+static bool mp_checksum_ok (const void *, size_t size);
+static intr_handler_func ap_timer_interrupt;
+static intr_handler_func resched_interrupt;
+
+/* Finds the CPUs from the MP configuration table, if there is
+   one.  The table may lie in RAM that the page allocator gives
+   out, so this must be called before palloc_init(). */
+void
+smp_init (void)
+{
+  struct mp_fp *fp;
+  struct mp_config *config;
+  uint8_t *entry, *end;
+  bool bsp_found = false;
+  unsigned i;
+
+  cpu_found = 1;
+  fp = mp_search ();
+  if (fp == NULL || fp->config == 0 || fp->type != 0)
+    return;
+  if (fp->config + sizeof *config > init_ram_pages * PGSIZE)
+    return;
+  config = ptov (fp->config);
+  if (memcmp (config->signature, "PCMP", 4)
+      || fp->config + config->length > init_ram_pages * PGSIZE
+      || !mp_checksum_ok (config, config->length))
+    return;
+
+  cpu_found = 0;
+  entry = (uint8_t *) (config + 1);
+  end = (uint8_t *) config + config->length;
+  for (i = 0; i < config->entry_cnt && entry < end; i++)
+    {
+      if (*entry == MP_PROCESSOR)
+        {
+          struct mp_processor *p = (struct mp_processor *) entry;
+
+          if ((p->flags & MP_ENABLED) && cpu_found < CPU_MAX)
+            apic_ids[cpu_found++] = p->apic_id;
+          if ((p->flags & MP_ENABLED) && (p->flags & MP_BSP))
+            {
+              /* Keep the boot CPU at index 0. */
+              apic_ids[cpu_found - 1] = apic_ids[0];
+              apic_ids[0] = p->apic_id;
+              bsp_found = true;
+            }
+          entry += sizeof *p;
+        }
+      else if (*entry <= MP_LINTR)
+        entry += 8;
+      else
+        break;
+    }
+  if (bsp_found && cpu_found > 1)
+    lapic_paddr = config->lapic;
+  else
+    cpu_found = 1;
+}
+
+/* Starts the other CPUs found by smp_init(), if any.  Must be
+   called with interrupts on, after the timer is calibrated and
+   before the first user process is created. */
+void
+smp_start (void)
+{
+  uint8_t *code = ptov (AP_START);
+  uint32_t *pd;
+  unsigned i;
+
+  ASSERT (intr_get_level () == INTR_ON);
+
+  if (cpu_found <= 1)
+    return;
+
+  lapic_init (lapic_paddr);
+  lapic_calibrate ();
+  intr_register_ext (LAPIC_TIMER_VEC, ap_timer_interrupt, "APIC Timer");
+  intr_register_ext (LAPIC_RESCHED_VEC, resched_interrupt,
+                     "Reschedule IPI");
+
+  /* The APs start out with a copy of the kernel's page
+     directory that also maps the first 4 MB of physical memory
+     at virtual address 0, where the startup code runs until it
+     jumps into the kernel. */
+  pd = palloc_get_page (PAL_ASSERT);
+  memcpy (pd, init_page_dir, PGSIZE);
+  pd[0] = pd[pd_no (PHYS_BASE)];
+
+  memcpy (code, ap_start, ap_start_end - ap_start);
+  *(uint32_t *) (code + (ap_gdt_base - ap_start))
+    = (uint32_t) (code + (ap_gdt - ap_start));
+  *(uint32_t *) (code + (ap_cr3 - ap_start)) = vtop (pd);
+
+  intr_lock_init ();
+  for (i = 1; i < cpu_found; i++)
+    {
+      struct thread *idle = thread_prepare_ap (i);
+      int ms;
+
+      ap_stack = (uint8_t *) idle + PGSIZE;
+      ap_started = false;
+      lapic_start_ap (apic_ids[i], AP_START);
+      for (ms = 0; !ap_started && ms < AP_START_TIMEOUT; ms++)
+        timer_mdelay (1);
+      if (!ap_started)
+        {
+          /* Leave PD and the idle thread alone, in case the AP
+             starts after all. */
+          printf ("CPU %u (APIC %u) did not start.\n", i, apic_ids[i]);
+          return;
+        }
+    }
+  palloc_free_page (pd);
+  printf ("%u CPUs online.\n", thread_cpu_cnt ());
+}
+
+/* Sends a reschedule interrupt to CPU, so that it looks at its
+   run queue again: to run a thread that was put there, if it
+   outranks the thread that CPU is running, or, if the CPU is
+   idle, to steal one. */
+void
+smp_kick (unsigned cpu)
+{
+  ASSERT (cpu < cpu_found);
+
+  lapic_send_ipi (apic_ids[cpu], LAPIC_RESCHED_VEC);
+}
+
+/* Called by ap-start.S on an AP, with interrupts off, on the
+   stack of the idle thread that smp_start() made for it. */
+void
+ap_main (void)
+{
+  /* Switch to the kernel's page directory, dropping the mapping
+     of low memory along with any TLB entries for it. */
+  asm volatile ("movl %0, %%cr3" : : "r" (vtop (init_page_dir)) : "memory");
+
+  intr_init_ap ();
+  lapic_init_ap ();
+  thread_start_ap (&ap_started);
+}
+
+/* Looks for the MP floating pointer structure in the places
+   given by [MP] 4: the first kB of the extended BIOS data area,
+   the last kB of base memory, and the BIOS ROM.  Returns it, or
+   a null pointer if there is none. */
+static struct mp_fp *
+mp_search (void)
+{
+  uint8_t *bda = ptov (0x400);
+  uintptr_t ebda = (uintptr_t) *(uint16_t *) (bda + 0x0e) << 4;
+  uintptr_t base_kb = *(uint16_t *) (bda + 0x13);
+  struct mp_fp *fp = NULL;
+
+  if (ebda != 0)
+    fp = mp_search_range (ebda, 1024);
+  if (fp == NULL && base_kb > 1)
+    fp = mp_search_range (base_kb * 1024 - 1024, 1024);
+  if (fp == NULL)
+    fp = mp_search_range (0xf0000, 0x10000);
+  return fp;
+}
+
+/* Looks for the MP floating pointer structure in the SIZE bytes
+   at physical address PADDR. */
+static struct mp_fp *
+mp_search_range (uintptr_t paddr, size_t size)
+{
+  uint8_t *p = ptov (paddr);
+  uint8_t *end = p + size;
+
+  for (; p + sizeof (struct mp_fp) <= end; p += 16)
+    if (!memcmp (p, "_MP_", 4) && mp_checksum_ok (p, sizeof (struct mp_fp)))
+      return (struct mp_fp *) p;
+  return NULL;
+}
+
+/* Returns true if the SIZE bytes at P sum to 0 modulo 256, as
+   the MP tables' do. */
+static bool
+mp_checksum_ok (const void *p_, size_t size)
+{
+  const uint8_t *p = p_;
+  uint8_t sum = 0;
+
+  while (size-- > 0)
+    sum += *p++;
+  return sum == 0;
+}
+
+/* Local APIC timer interrupt handler, on the APs.  The boot CPU
+   gets its ticks from the PIT instead; see timer.c. */
+static void
+ap_timer_interrupt (struct intr_frame *args UNUSED)
+{
+  thread_tick ();
+}
+
+/* Reschedule interrupt handler.  See smp_kick(). */
+static void
+resched_interrupt (struct intr_frame *args UNUSED)
+{
+  thread_check_preempt ();
+}
@@ -0,0 +1,11 @@
+#ifndef THREADS_SMP_H
+#define THREADS_SMP_H
+
+/* Most CPUs the kernel will run on. */
+#define CPU_MAX 8
+
+void smp_init (void);
+void smp_start (void);
+void smp_kick (unsigned cpu);
+
+#endif /* threads/smp.h */
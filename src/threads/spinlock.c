@@ -0,0 +1,61 @@
+#include "threads/spinlock.h"
+#include <debug.h>
+#include <stddef.h>
+
+/* Atomically stores NEW in *P and returns the old value. */
+static inline uint32_t
+xchg (volatile uint32_t *p, uint32_t new) 
+{
+  asm volatile ("xchgl %0, %1" : "+r" (new), "+m" (*p) : : "memory");
+  return new;
+}
+
+/* Initializes LOCK as a spin lock that nobody holds. */
+void
+spinlock_init (struct spinlock *lock) 
+{
+  ASSERT (lock != NULL);
+
+  lock->locked = 0;
+  lock->old_level = INTR_OFF;
+}
+
+/* Disables interrupts and acquires LOCK, spinning until it is
+   free.  May be called from an interrupt handler. */
+void
+spinlock_acquire (struct spinlock *lock) 
+{
+  enum intr_level old_level;
+
+  ASSERT (lock != NULL);
+
+  old_level = intr_disable ();
+  while (xchg (&lock->locked, 1) != 0)
+    while (lock->locked)
+      asm volatile ("pause");
+  lock->old_level = old_level;
+}
+
+/* Releases LOCK and restores the interrupt level from before it
+   was acquired. */
+void
+spinlock_release (struct spinlock *lock) 
+{
+  enum intr_level old_level;
+
+  ASSERT (spinlock_held (lock));
+
+  old_level = lock->old_level;
+  xchg (&lock->locked, 0);
+  intr_set_level (old_level);
+}
+
+/* Returns true if LOCK is held.  With interrupts off, on a
+   uniprocessor, this means it is held by the current code. */
+bool
+spinlock_held (const struct spinlock *lock) 
+{
+  ASSERT (lock != NULL);
+
+  return lock->locked != 0;
+}
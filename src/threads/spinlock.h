@@ -0,0 +1,39 @@
+#ifndef THREADS_SPINLOCK_H
+#define THREADS_SPINLOCK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "threads/interrupt.h"
+
+/* Spin lock.
+
+   A spin lock protects data that is touched with interrupts off,
+   such as the page allocator's pools, where a struct lock cannot
+   be used because its holder may not sleep.  Acquiring a spin
+   lock disables interrupts, which excludes other code on the
+   same CPU and, once more than one CPU runs, takes the kernel
+   lock that excludes the other CPUs (see interrupt.c).  It then
+   takes the spin lock itself with an atomic exchange, which
+   always succeeds at once while the kernel lock is held, so a
+   spin lock costs about as much as the intr_disable() it wraps.
+   It names the data it protects, which a bare intr_disable()
+   does not.
+
+   A spin lock must not be held across anything that sleeps, and
+   nested spin locks must be released in the opposite order to
+   that in which they were acquired. */
+struct spinlock 
+  {
+    volatile uint32_t locked;   /* 1 if held, 0 if not. */
+    enum intr_level old_level;  /* Interrupt level before acquire. */
+  };
+
+/* Initializer for a spin lock that nobody holds. */
+#define SPINLOCK_INITIALIZER { 0, INTR_OFF }
+
+void spinlock_init (struct spinlock *);
+void spinlock_acquire (struct spinlock *);
+void spinlock_release (struct spinlock *);
+bool spinlock_held (const struct spinlock *);
+
+#endif /* threads/spinlock.h */
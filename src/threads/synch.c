@@ -27,10 +27,14 @@
 */
 
 #include "threads/synch.h"
+#include <inttypes.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "devices/timer.h"
+
+static void wake_waiter (struct pqueue *, struct wake_batch *);
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -47,7 +51,7 @@ sema_init (struct semaphore *sema, unsigned value)
   ASSERT (sema != NULL);
 
   sema->value = value;
-  list_init (&sema->waiters);
+  pqueue_init (&sema->waiters);
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -68,23 +72,12 @@ sema_down (struct semaphore *sema)
   old_level = intr_disable ();
   while (sema->value == 0) 
     {
-      ////////////////////////////////////////
-      // prj(donation) - sungmin oh - start //
-      // if current thread want to use shared resources, it needs semaphore.
-      // to get semaphore, it have to wait in sema->waiters.
-      // we are going to maintain this list ordered by priority
-      // we can achieve this condition because there are no more insert isntruction for sema->waiters.
-      list_insert_ordered(&sema->waiters, &thread_current()->elem, (list_less_func*)&higher_priority, NULL);
-      
-      /* original code. no need anymore.
-       *
-      list_push_back (&sema->waiters, &thread_current ()->elem);
-      *
-      */
-      // prj(donation) - sungmin oh - end //
-      //////////////////////////////////////
+      struct thread *cur = thread_current ();
+
+      cur->wait_queue = &sema->waiters;
+      pqueue_push (&sema->waiters, &cur->wait_elem, cur->priority);
       thread_block ();
-   }
+    }
   sema->value--;
   intr_set_level (old_level);
 }
@@ -123,44 +116,36 @@ void
 sema_up (struct semaphore *sema) 
 {
   enum intr_level old_level;
+  struct wake_batch batch;
 
   ASSERT (sema != NULL);
 
+  wake_batch_init (&batch);
   old_level = intr_disable ();
+  if (!pqueue_empty (&sema->waiters)) 
+    wake_waiter (&sema->waiters, &batch);
+  sema->value++;
 
-  /////////////////////////////////////////  
-  // prj1(donation - sungmin oh - start) //
-  struct thread* highest_thread = NULL;
-  // prj1(donation) - sungmin oh - end) //
-  ////////////////////////////////////////
-  
-  if (!list_empty (&sema->waiters)){ 
-
-    /////////////////////////////////////////
-    // prj1(donation) - sungmin oh - start //
-    // waiter is not in sorted order. so have to sort to bet hihgest element
-    list_sort(&sema->waiters, (list_less_func*)&higher_priority, NULL);
-    highest_thread = list_entry(list_front(&sema->waiters), struct thread, elem);
-    // prj1(donation) - sungmin oh - end) //
-    ////////////////////////////////////////
-    
-    thread_unblock (list_entry (list_pop_front (&sema->waiters),
-                                struct thread, elem));
-  }
-  sema->value++; 
-
-  /////////////////////////////////////////
-  // prj1(donation) - sungmin oh - start //
-  // if highest thraed in waiters is prior to current thread, thread_yield has to be called
-  if(!intr_context() && (highest_thread != NULL) && (highest_thread->priority > thread_get_priority())){
-    thread_yield();
-  }
-  // prj1(donation) - sungmin oh - end) //
-  ////////////////////////////////////////
- 
+  /* Let the thread we woke run now if it outranks us. */
+  wake_batch_finish (&batch, true);
   intr_set_level (old_level);
 }
 
+/* Removes the first thread from WAITERS and wakes it up as part
+   of BATCH.  Interrupts must be off. */
+static void
+wake_waiter (struct pqueue *waiters, struct wake_batch *batch) 
+{
+  struct thread *t = pqueue_entry (pqueue_pop (waiters),
+                                   struct thread, wait_elem);
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  t->wait_queue = NULL;
+  if (t->status == THREAD_BLOCKED)
+    wake_batch_add (batch, t);
+}
+
 static void sema_test_helper (void *sema_);
 
 /* Self-test for semaphores that makes control "ping-pong"
@@ -198,6 +183,55 @@ sema_test_helper (void *sema_)
     }
 }
 
+/* Limit on nested priority donation. */
+unsigned lock_donation_depth = LOCK_DONATION_DEPTH;
+
+/* Lock contention profiling. */
+bool lock_profile;
+
+/* Statistics for one call site of lock_acquire() or
+   lock_try_acquire().  Times are in TSC cycles, since most waits
+   and holds are far shorter than a timer tick. */
+struct lock_site 
+  {
+    void *pc;                   /* Return address of the call. */
+    unsigned acquisitions;      /* # of times lock acquired. */
+    unsigned contended;         /* # of times lock was busy. */
+    unsigned donations;         /* # of times waiting donated priority. */
+    uint64_t wait_total;        /* Total cycles waiting for lock. */
+    uint64_t wait_max;          /* Longest wait. */
+    uint64_t hold_total;        /* Total cycles holding lock. */
+    uint64_t hold_max;          /* Longest hold. */
+  };
+
+/* Call sites, in a hash table with linear probing.  Statically
+   allocated, because malloc() itself takes locks. */
+#define LOCK_SITE_CNT 256
+static struct lock_site lock_sites[LOCK_SITE_CNT];
+static unsigned lock_sites_used;
+static unsigned lock_sites_dropped;     /* # of acquisitions not
+                                           recorded: table full. */
+
+static bool donate_priority (struct lock *, int priority);
+static void lock_update_max_priority (struct lock *);
+static struct lock_site *lock_site_lookup (void *pc);
+static void lock_profile_acquired (struct lock *, struct lock_site *,
+                                   uint64_t start);
+static void lock_profile_released (struct lock *);
+
+/* Returns true if lock A, held by some thread, has a lower
+   highest-priority waiter than lock B.  Orders a thread's
+   held_locks heap. */
+bool
+lock_priority_less (const struct heap_elem *a_, const struct heap_elem *b_,
+                    void *aux UNUSED) 
+{
+  const struct lock *a = heap_entry (a_, struct lock, elem);
+  const struct lock *b = heap_entry (b_, struct lock, elem);
+
+  return a->max_priority < b->max_priority;
+}
+
 /* Initializes LOCK.  A lock can be held by at most a single
    thread at any given time.  Our locks are not "recursive", that
    is, it is an error for the thread currently holding a lock to
@@ -220,76 +254,63 @@ lock_init (struct lock *lock)
 
   lock->holder = NULL;
   sema_init (&lock->semaphore, 1);
+  lock->max_priority = PRI_MIN - 1;
+  lock->site = NULL;
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
    necessary.  The lock must not already be held by the current
    thread.
 
+   If LOCK is held, the current thread donates its priority to
+   the holder, and through it along the chain of locks that the
+   holder is waiting for, for as long as that raises a priority.
+
    This function may sleep, so it must not be called within an
    interrupt handler.  This function may be called with
    interrupts disabled, but interrupts will be turned back on if
    we need to sleep. */
-
-
-/////////////////////////////////////////
-// prj1(donation) - sungmin oh - start //
-void
-priority_donation(struct lock* target_lock){
-
-  struct thread* cur = thread_current();
-  // when loack is not null and there is holder already
-  if((target_lock != NULL) && (target_lock->holder != NULL)){
-    struct thread* lock_holder = target_lock->holder;
-    // when lock_hodler's priority is less than current thread which needs same lock, currrent thread donate priority to lock_holder.
-    if(lock_holder->priority < cur->priority){
-      // if this is first donation for lock_holder, set donated variable to true
-      if(!lock_holder->donated){
-        //lock_holder->original_priority = lock_holder->priority; // no need.
-        lock_holder->donated = true;
-      }
-
-      lock_holder->priority = cur->priority;  // donation
-      // if lock_holder is locked because it needs another lock which is already taken, priority_donation have to be executed recursively. else the value of lock_holder->locked is null, recursive call will not do anything.
-      priority_donation(lock_holder->locked);
-    } 
-  }
-}
-// prj1(donation) - sungmin oh - end //
-///////////////////////////////////////
-
-
 void
 lock_acquire (struct lock *lock)
 {
+  struct thread *cur = thread_current ();
+  struct lock_site *site = NULL;
+  enum intr_level old_level;
+  uint64_t start = 0;
+
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (!lock_held_by_current_thread (lock));
 
-  /////////////////////////////////////////
-  // prj1(donation) - sungmin oh - start //
-  struct thread* cur = thread_current();
-  // donate priority to holder of this lock.
-  priority_donation(lock);
+  old_level = intr_disable ();
+  if (lock_profile)
+    {
+      site = lock_site_lookup (__builtin_return_address (0));
+      start = timer_rdtsc ();
+      if (site != NULL && lock->semaphore.value == 0)
+        site->contended++;
+    }
+  if (lock->holder != NULL && !thread_mlfqs)
+    {
+      cur->waiting_lock = lock;
+      if (donate_priority (lock, cur->priority) && site != NULL)
+        site->donations++;
+    }
 
-  // try to get lock
-  cur->locked = lock;  
-  sema_down(&lock->semaphore);
+  sema_down (&lock->semaphore);
+  if (site != NULL)
+    lock_profile_acquired (lock, site, start);
 
-  // if current thread get lock
-  cur->locked = NULL;
+  cur->waiting_lock = NULL;
   lock->holder = cur;
-  list_push_front(&cur->lock_list, &lock->elem);
-
-  /* original code
-   *
-  sema_down (&lock->semaphore);
-  lock->holder = thread_current ();
-  *
-  */
-  
-  // prj1(donation) - sungmin oh - end //
-  ///////////////////////////////////////
+  if (!thread_mlfqs)
+    {
+      /* Threads still waiting for LOCK now donate to us. */
+      lock_update_max_priority (lock);
+      heap_insert (&cur->held_locks, &lock->elem);
+      thread_update_priority (cur);
+    }
+  intr_set_level (old_level);
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -301,96 +322,83 @@ lock_acquire (struct lock *lock)
 bool
 lock_try_acquire (struct lock *lock)
 {
+  enum intr_level old_level;
   bool success;
 
   ASSERT (lock != NULL);
   ASSERT (!lock_held_by_current_thread (lock));
 
+  old_level = intr_disable ();
   success = sema_try_down (&lock->semaphore);
   if (success)
-    lock->holder = thread_current ();
+    {
+      lock->holder = thread_current ();
+      if (!thread_mlfqs)
+        heap_insert (&lock->holder->held_locks, &lock->elem);
+      if (lock_profile)
+        {
+          struct lock_site *site;
+
+          site = lock_site_lookup (__builtin_return_address (0));
+          if (site != NULL)
+            lock_profile_acquired (lock, site, timer_rdtsc ());
+        }
+    }
+  intr_set_level (old_level);
   return success;
 }
 
-/////////////////////////////////////////
-// prj1(donation) - sungmin oh - start //
-// this function is used in list_less_func type function
-// so if first parameter is smaller than second parameter, return false. else true.
-bool
-cmp_sema(struct semaphore* A, struct semaphore* B){
-  struct list* a_waiters = &A->waiters;
-  struct list* b_waiters = &B->waiters;
-
-  // if second parameter is empty then first parameter is clearly higher. return false.
-  // opposite case, return true.
-  if(list_empty(b_waiters)){
-    return false;
-  }else if(list_empty(a_waiters)){
-    return true;
-  }else{
-    // if both are not empty, find the highest waiter from each semaphore, then compare them
-    list_sort(a_waiters, (list_less_func*)&higher_priority, NULL);
-    list_sort(b_waiters, (list_less_func*)&higher_priority, NULL);
-    struct thread* a_highest_thread = list_entry(list_front(a_waiters), struct thread, elem);
-    struct thread* b_highest_thread = list_entry(list_front(b_waiters), struct thread, elem);
-
-    return a_highest_thread->priority < b_highest_thread->priority;
-  }
-}
-
-// if first parameter(actually lock) has lower priority thread in waiters list, return true.
-bool
-higher_lock(const struct list_elem* A, const struct list_elem* B, void* aux_unused){
-  struct lock* a_lock = list_entry(A, struct lock, elem);
-  struct lock* b_lock = list_entry(B, struct lock, elem);
-  struct semaphore* a_sema = &a_lock->semaphore;
-  struct semaphore* b_sema = &b_lock->semaphore;
+/* Donates PRIORITY, that of a thread about to wait for LOCK, to
+   LOCK's holder, then on to the holder of the lock that it is
+   waiting for, and so on, stopping when a priority would not
+   rise or after lock_donation_depth locks.  Each step costs
+   O(log n) heap work, so donation never rescans waiters.
+   thread_set_effective_priority() moves each holder that is
+   itself waiting to its new place in its wait queue.
+   Returns true if any thread's priority was raised.
+   Interrupts must be off. */
+static bool
+donate_priority (struct lock *lock, int priority) 
+{
+  bool donated = false;
+  unsigned depth;
 
-  return cmp_sema(a_sema,b_sema);
-}
+  ASSERT (intr_get_level () == INTR_OFF);
 
+  for (depth = 0; lock != NULL && depth < lock_donation_depth; depth++) 
+    {
+      struct thread *holder = lock->holder;
+
+      if (holder == NULL || priority <= lock->max_priority)
+        break;
+      lock->max_priority = priority;
+      heap_increase (&holder->held_locks, &lock->elem);
+
+      if (priority <= holder->priority)
+        break;
+      thread_set_effective_priority (holder, priority);
+      donated = true;
+      lock = holder->waiting_lock;
+    }
+  return donated;
+}
 
+/* Recomputes LOCK's max_priority from the threads waiting for
+   it, after the first of them has taken the lock.  LOCK must not
+   be in any held_locks heap.  Interrupts must be off. */
+static void
+lock_update_max_priority (struct lock *lock) 
+{
+  struct pqueue *waiters = &lock->semaphore.waiters;
 
-void
-donation_rollback(struct lock* target_lock){
-  // remove lock from lock_list of its holder
-  list_remove(&target_lock->elem);
-
-  // this function is called by current thread, so current thread is holder.
-  struct thread* holder = thread_current();
-  
-  // if there are no more lock current thread have, no more donation
-  if(list_empty(&holder->lock_list)){
-    holder->priority = holder->original_priority;
-    holder->donated = false;
-  }else{
-    // if the current thread has some other locks, find highest priority thread among waiters of all locks 
-    struct lock* highest_lock = list_entry(list_max(&holder->lock_list, (list_less_func*)&higher_lock, NULL), struct lock, elem);
-    struct list* lock_waiters = &(highest_lock->semaphore).waiters;
-    
-    // but if there are no waiter in all locks, then no more donation
-    if(list_empty(lock_waiters)){
-      holder->priority = holder->original_priority;
-      holder->donated = false;
-    }else{
-
-      // if there is, compare priority with original priority of current thraed
-      struct thread* highest_thread = list_entry(list_front(lock_waiters), struct thread, elem);
-      int next_priority = highest_thread->priority;
-      // if original priority is higher or equal to, no need donation
-      if(holder->original_priority >= next_priority){
-        holder->priority = holder->original_priority;
-        holder->donated = false;
-      }else{
-        holder->priority = next_priority;
-      }
-    } 
-  }
+  if (pqueue_empty (waiters))
+    lock->max_priority = PRI_MIN - 1;
+  else
+    lock->max_priority = pqueue_front (waiters)->priority;
 }
-// prj1(donation) - sungmin oh - end //
-///////////////////////////////////////
 
 /* Releases LOCK, which must be owned by the current thread.
+   The current thread gives up the priority donated through LOCK.
 
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to release a lock within an interrupt
@@ -398,18 +406,28 @@ donation_rollback(struct lock* target_lock){
 void
 lock_release (struct lock *lock) 
 {
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
   ASSERT (lock != NULL);
   ASSERT (lock_held_by_current_thread (lock));
 
-  /////////////////////////////////////////
-  // prj1(donation) - sungmin oh - start //
-  // restore priority
-  donation_rollback(lock);
-  // prj1(donation) - sungmin oh - end //
-  ///////////////////////////////////////
-
+  old_level = intr_disable ();
+  if (lock->site != NULL)
+    lock_profile_released (lock);
+  if (!thread_mlfqs)
+    {
+      heap_remove (&cur->held_locks, &lock->elem);
+      thread_update_priority (cur);
+    }
   lock->holder = NULL;
   sema_up (&lock->semaphore);
+
+  /* A thread that cond_signal() or cond_broadcast() woke while we
+     held LOCK, or one that outranks us now that we have lost
+     LOCK's donations, may be ready to run in our place. */
+  thread_check_preempt ();
+  intr_set_level (old_level);
 }
 
 /* Returns true if the current thread holds LOCK, false
@@ -422,49 +440,324 @@ lock_held_by_current_thread (const struct lock *lock)
 
   return lock->holder == thread_current ();
 }
-/* One semaphore in a list. */
-struct semaphore_elem 
-  {
-    struct list_elem elem;              /* List element. */
-    struct semaphore semaphore;         /* This semaphore. */
-  };
 
-/* Initializes condition variable COND.  A condition variable
-   allows one piece of code to signal a condition and cooperating
-   code to receive the signal and act upon it. */
+/* Returns the statistics for call site PC, creating them if
+   necessary, or a null pointer if the table is full.
+   Interrupts must be off. */
+static struct lock_site *
+lock_site_lookup (void *pc) 
+{
+  unsigned i = ((uintptr_t) pc * 2654435761u) % LOCK_SITE_CNT;
+  unsigned probes;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  for (probes = 0; probes < LOCK_SITE_CNT; probes++) 
+    {
+      struct lock_site *site = &lock_sites[i];
+      if (site->pc == pc)
+        return site;
+      if (site->pc == NULL)
+        {
+          site->pc = pc;
+          lock_sites_used++;
+          return site;
+        }
+      i = (i + 1) % LOCK_SITE_CNT;
+    }
+  lock_sites_dropped++;
+  return NULL;
+}
+
+/* Records that LOCK was acquired at SITE after waiting since
+   TSC value START.  Interrupts must be off. */
+static void
+lock_profile_acquired (struct lock *lock, struct lock_site *site,
+                       uint64_t start) 
+{
+  uint64_t now = timer_rdtsc ();
+  uint64_t wait = now - start;
+
+  site->acquisitions++;
+  site->wait_total += wait;
+  if (wait > site->wait_max)
+    site->wait_max = wait;
+  lock->site = site;
+  lock->acquired_at = now;
+}
+
+/* Records that LOCK is being released.  Interrupts must be
+   off. */
+static void
+lock_profile_released (struct lock *lock) 
+{
+  uint64_t hold = timer_rdtsc () - lock->acquired_at;
+
+  lock->site->hold_total += hold;
+  if (hold > lock->site->hold_max)
+    lock->site->hold_max = hold;
+  lock->site = NULL;
+}
+
+/* Prints lock contention statistics, one line per call site,
+   in order of decreasing total wait.  The call sites can be
+   translated to functions and line numbers with the `backtrace'
+   utility. */
+void
+lock_print_stats (void) 
+{
+  struct lock_site *sites[LOCK_SITE_CNT];
+  enum intr_level old_level;
+  unsigned cnt = 0;
+  unsigned i;
+
+  if (!lock_profile)
+    return;
+
+  old_level = intr_disable ();
+
+  /* Collect the used sites and insertion sort them. */
+  for (i = 0; i < LOCK_SITE_CNT; i++)
+    if (lock_sites[i].pc != NULL) 
+      {
+        struct lock_site *site = &lock_sites[i];
+        unsigned j;
+
+        for (j = cnt++; j > 0 && sites[j - 1]->wait_total < site->wait_total;
+             j--)
+          sites[j] = sites[j - 1];
+        sites[j] = site;
+      }
+
+  printf ("Locks: %u call sites", lock_sites_used);
+  if (lock_sites_dropped > 0)
+    printf (", %u acquisitions not recorded", lock_sites_dropped);
+  printf (", times in TSC cycles\n");
+  printf ("Locks: %10s %8s %8s %8s %12s %10s %12s %10s\n",
+          "site", "acquired", "contend", "donated",
+          "wait total", "wait max", "hold total", "hold max");
+  for (i = 0; i < cnt; i++) 
+    {
+      struct lock_site *site = sites[i];
+      printf ("Locks: %10p %8u %8u %8u %12"PRIu64" %10"PRIu64
+              " %12"PRIu64" %10"PRIu64"\n",
+              site->pc, site->acquisitions, site->contended,
+              site->donations, site->wait_total, site->wait_max,
+              site->hold_total, site->hold_max);
+    }
+
+  intr_set_level (old_level);
+}
+/* Initializes RWLOCK as a readers-writer lock that nobody
+   holds.
+
+   A readers-writer lock is built from a lock, `writer', that a
+   writer holds for as long as it writes, plus a count of
+   readers.  A reader only holds `writer' long enough to count
+   itself in, so readers run concurrently, but a reader that
+   arrives while a writer holds `writer' or waits for it waits
+   behind the writer, which gives writers preference.  A writer
+   that gets `writer' while readers are still counted in sleeps
+   on `drained' until the last of them leaves.  Because waiting
+   for a writer is waiting for `writer', readers and writers
+   donate their priority to the writer. */
+void
+rwlock_init (struct rwlock *rwlock) 
+{
+  ASSERT (rwlock != NULL);
+
+  lock_init (&rwlock->writer);
+  rwlock->readers = 0;
+  rwlock->writers = 0;
+  rwlock->write_cnt = 0;
+  rwlock->draining = false;
+  sema_init (&rwlock->drained, 0);
+}
+
+/* Acquires RWLOCK for reading, sleeping until no writer holds or
+   is waiting for it.  The current thread must not already hold
+   RWLOCK for writing.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_read (struct rwlock *rwlock) 
+{
+  ASSERT (rwlock != NULL);
+  ASSERT (!intr_context ());
+
+  lock_acquire (&rwlock->writer);
+  rwlock->readers++;
+  lock_release (&rwlock->writer);
+}
+
+/* Releases RWLOCK, which the current thread must hold for
+   reading.  If this was the last reader and a writer is waiting,
+   wakes the writer. */
+void
+rwlock_release_read (struct rwlock *rwlock) 
+{
+  enum intr_level old_level;
+
+  ASSERT (rwlock != NULL);
+  ASSERT (rwlock->readers > 0);
+
+  old_level = intr_disable ();
+  if (--rwlock->readers == 0 && rwlock->draining)
+    {
+      rwlock->draining = false;
+      sema_up (&rwlock->drained);
+    }
+  intr_set_level (old_level);
+}
+
+/* Waits until every reader of RWLOCK has left.  The current
+   thread must hold RWLOCK->writer, so no new readers can
+   arrive. */
+static void
+rwlock_drain (struct rwlock *rwlock) 
+{
+  enum intr_level old_level;
+
+  ASSERT (lock_held_by_current_thread (&rwlock->writer));
+
+  old_level = intr_disable ();
+  if (rwlock->readers > 0)
+    {
+      rwlock->draining = true;
+      sema_down (&rwlock->drained);
+    }
+  intr_set_level (old_level);
+}
+
+/* Acquires RWLOCK for writing, sleeping until no other thread
+   holds it.  The current thread must not already hold RWLOCK.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_write (struct rwlock *rwlock) 
+{
+  enum intr_level old_level;
+
+  ASSERT (rwlock != NULL);
+  ASSERT (!intr_context ());
+
+  old_level = intr_disable ();
+  rwlock->writers++;
+  intr_set_level (old_level);
+
+  lock_acquire (&rwlock->writer);
+  rwlock_drain (rwlock);
+  rwlock->write_cnt++;
+}
+
+/* Releases RWLOCK, which the current thread must hold for
+   writing. */
+void
+rwlock_release_write (struct rwlock *rwlock) 
+{
+  enum intr_level old_level;
+
+  ASSERT (rwlock != NULL);
+  ASSERT (rwlock_held_for_write (rwlock));
+
+  old_level = intr_disable ();
+  rwlock->writers--;
+  intr_set_level (old_level);
+
+  lock_release (&rwlock->writer);
+}
 
-/////////////////////////////////////
-// prj1(cond) - sungmin oh - start //
-// used as list_less_func type parameter
+/* Converts the current thread's read hold on RWLOCK into a write
+   hold, waiting for any other readers to leave, and returns
+   true.
+
+   If another writer holds RWLOCK or is waiting for it, that
+   writer is in turn waiting for us to stop reading, so the
+   upgrade cannot be done without letting it write first.  In
+   that case, returns false at once, and the current thread still
+   holds RWLOCK for reading.  The same happens, after a wait, if
+   a writer arrives and gets in ahead of us while we wait for a
+   reader that holds `writer' just long enough to count itself
+   in; then the current thread holds RWLOCK for reading again,
+   but the writer has run in between.  Either way, the caller
+   may then release the read hold, acquire RWLOCK for writing,
+   and recheck whatever it read.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
 bool
-higher_cond(const struct list_elem* A, const struct list_elem* B, void* aux_unused){
-  struct semaphore_elem* a = list_entry(A, struct semaphore_elem, elem);
-  struct semaphore_elem* b = list_entry(B, struct semaphore_elem, elem);
-  struct list* a_waiters = &(a->semaphore).waiters;
-  struct list* b_waiters = &(b->semaphore).waiters;
-
-  if(list_empty(b_waiters)){
-    return true;
-  }else if(list_empty(a_waiters)){
-    return false;
-  }else{
-    list_sort(a_waiters, (list_less_func*)&higher_priority, NULL);
-    list_sort(b_waiters, (list_less_func*)&higher_priority, NULL);
-    struct thread* a_highest_thread = list_entry(list_front(a_waiters), struct thread, elem);
-    struct thread* b_highest_thread = list_entry(list_front(b_waiters), struct thread, elem);
-
-    return a_highest_thread->priority > b_highest_thread->priority; 
-  } 
-}
-// prj1(cond) - sungmin oh - end //
-///////////////////////////////////
+rwlock_upgrade (struct rwlock *rwlock) 
+{
+  enum intr_level old_level;
+  unsigned write_cnt;
+
+  ASSERT (rwlock != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (rwlock->readers > 0);
 
+  old_level = intr_disable ();
+  if (rwlock->writers > 0)
+    {
+      intr_set_level (old_level);
+      return false;
+    }
+  write_cnt = rwlock->write_cnt;
+  intr_set_level (old_level);
+
+  /* Stop reading before waiting for `writer', so that a writer
+     that gets it first does not wait for us in turn.  No writer
+     can finish acquiring RWLOCK while we read, so WRITE_CNT
+     tells whether one got in. */
+  rwlock_release_read (rwlock);
+  rwlock_acquire_write (rwlock);
+  if (rwlock->write_cnt != write_cnt + 1)
+    {
+      rwlock_downgrade (rwlock);
+      return false;
+    }
+  return true;
+}
+
+/* Converts the current thread's write hold on RWLOCK into a read
+   hold, without letting any writer in between.  Readers waiting
+   for RWLOCK may then proceed. */
+void
+rwlock_downgrade (struct rwlock *rwlock) 
+{
+  enum intr_level old_level;
+
+  ASSERT (rwlock != NULL);
+  ASSERT (rwlock_held_for_write (rwlock));
+
+  old_level = intr_disable ();
+  rwlock->readers++;
+  rwlock->writers--;
+  intr_set_level (old_level);
+
+  lock_release (&rwlock->writer);
+}
+
+/* Returns true if the current thread holds RWLOCK for writing,
+   false otherwise. */
+bool
+rwlock_held_for_write (const struct rwlock *rwlock) 
+{
+  ASSERT (rwlock != NULL);
+
+  return lock_held_by_current_thread (&rwlock->writer);
+}
+
+/* Initializes condition variable COND.  A condition variable
+   allows one piece of code to signal a condition and cooperating
+   code to receive the signal and act upon it. */
 void
 cond_init (struct condition *cond)
 {
   ASSERT (cond != NULL);
 
-  list_init (&cond->waiters);
+  pqueue_init (&cond->waiters);
 }
 
 /* Atomically releases LOCK and waits for COND to be signaled by
@@ -490,27 +783,27 @@ cond_init (struct condition *cond)
 void
 cond_wait (struct condition *cond, struct lock *lock) 
 {
-  struct semaphore_elem waiter;
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
 
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (lock_held_by_current_thread (lock));
-  
-  sema_init (&waiter.semaphore, 0);
-
-  /////////////////////////////////////
-  // prj1(cond) - sungmin oh - start //
-  list_insert_ordered(&cond->waiters, &waiter.elem, (list_less_func*)&higher_cond, NULL);
-  // prj1(cond) - sungmin oh - end //
-  ///////////////////////////////////
-  /* original code
-   *
-  list_push_back (&cond->waiters, &waiter.elem);
-  *
-  */
+
+  /* Join the queue before releasing LOCK, so that a signal sent
+     as soon as LOCK is free finds us.  Releasing LOCK may yield
+     to a higher-priority thread that signals us while we are
+     still ready to run, so block only if that has not happened:
+     wake_waiter() clears wait_queue when it dequeues us. */
+  old_level = intr_disable ();
+  cur->wait_queue = &cond->waiters;
+  pqueue_push (&cond->waiters, &cur->wait_elem, cur->priority);
   lock_release (lock);
-  sema_down (&waiter.semaphore);
+  while (cur->wait_queue != NULL)
+    thread_block ();
+  intr_set_level (old_level);
+
   lock_acquire (lock);
 }
 
@@ -520,24 +813,28 @@ cond_wait (struct condition *cond, struct lock *lock)
 
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to signal a condition variable within an
-   interrupt handler. */
+   interrupt handler.
+
+   The woken thread must reacquire LOCK before it can get
+   anywhere, so we do not yield to it now even if it outranks us;
+   lock_release() does. */
 void
 cond_signal (struct condition *cond, struct lock *lock UNUSED) 
 {
+  enum intr_level old_level;
+  struct wake_batch batch;
+
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (lock_held_by_current_thread (lock));
 
-  if (!list_empty (&cond->waiters)){
-    /////////////////////////////////////
-    // prj1(cond) - sungmin oh - start //
-    list_sort(&cond->waiters, (list_less_func*)&higher_cond, NULL);
-    // prj1(cond) - sungmin oh - end //
-    ///////////////////////////////////
-    sema_up (&list_entry (list_pop_front (&cond->waiters),
-                          struct semaphore_elem, elem)->semaphore);
-  }
+  wake_batch_init (&batch);
+  old_level = intr_disable ();
+  if (!pqueue_empty (&cond->waiters))
+    wake_waiter (&cond->waiters, &batch);
+  wake_batch_finish (&batch, false);
+  intr_set_level (old_level);
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -545,13 +842,27 @@ cond_signal (struct condition *cond, struct lock *lock UNUSED)
 
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to signal a condition variable within an
-   interrupt handler. */
+   interrupt handler.
+
+   All the waiters are woken as one batch.  None of them can get
+   far before we release LOCK, so instead of yielding to any now,
+   only for it to block again on LOCK, we let lock_release() give
+   up the CPU once to the highest-ranking one. */
 void
-cond_broadcast (struct condition *cond, struct lock *lock) 
+cond_broadcast (struct condition *cond, struct lock *lock UNUSED) 
 {
+  enum intr_level old_level;
+  struct wake_batch batch;
+
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (lock_held_by_current_thread (lock));
 
-  while (!list_empty (&cond->waiters))
-    cond_signal (cond, lock);
+  wake_batch_init (&batch);
+  old_level = intr_disable ();
+  while (!pqueue_empty (&cond->waiters))
+    wake_waiter (&cond->waiters, &batch);
+  wake_batch_finish (&batch, false);
+  intr_set_level (old_level);
 }
@@ -1,14 +1,16 @@
 #ifndef THREADS_SYNCH_H
 #define THREADS_SYNCH_H
 
-#include <list.h>
+#include <heap.h>
+#include <pqueue.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 /* A counting semaphore. */
 struct semaphore 
   {
     unsigned value;             /* Current value. */
-    struct list waiters;        /* List of waiting threads. */
+    struct pqueue waiters;      /* Waiting threads, by priority. */
   };
 
 void sema_init (struct semaphore *, unsigned value);
@@ -19,38 +21,71 @@ void sema_self_test (void);
 
 /* Lock. */
 struct lock 
-{
-  /////////////////////////////////////////
-  // prj1(donation) - sungmin oh - start //
-  // to store lock in holder's list
-  struct list_elem elem;
-  // prj1(donation) - sungmin oh - end //
-  ///////////////////////////////////////
-  
-  struct thread *holder;      /* Thread holding lock (for debugging). */
-  struct semaphore semaphore; /* Binary semaphore controlling access. */
-};
-
-/////////////////////////////////////////
-// prj1(donation) - sungmin oh - start //
-void priority_donation(struct lock*);
-bool cmp_sema(struct semaphore*, struct semaphore*);
-bool higher_lock(const struct list_elem*, const struct list_elem*, void*);
-bool higher_cond(const struct list_elem*, const struct list_elem*, void*);
-void donation_rollback(struct lock*);
-// prj1(donation) - sungmin oh - end //
-///////////////////////////////////////
+  {
+    struct thread *holder;      /* Thread holding lock (for debugging). */
+    struct semaphore semaphore; /* Binary semaphore controlling access. */
+
+    /* Priority donation.  Not used by the advanced scheduler. */
+    int max_priority;           /* Highest priority among waiters. */
+    struct heap_elem elem;      /* Element in holder's held_locks. */
+
+    /* Contention profiling.  Used only if lock_profile. */
+    struct lock_site *site;     /* Statistics for holder's call site. */
+    uint64_t acquired_at;       /* TSC when holder acquired lock. */
+  };
+
+/* Default limit on the length of a chain of nested priority
+   donations.  A thread waiting for a lock whose holder is itself
+   waiting for a lock, and so on, donates its priority through at
+   most this many locks. */
+#define LOCK_DONATION_DEPTH 8
+
+/* Limit on nested priority donation.  Controlled by kernel
+   command-line option "-dd=DEPTH". */
+extern unsigned lock_donation_depth;
+
+/* If true, record lock contention statistics per call site of
+   lock_acquire() and print them at shutdown.  Controlled by
+   kernel command-line option "-lockprof". */
+extern bool lock_profile;
+
+heap_less_func lock_priority_less;
 
 void lock_init (struct lock *);
 void lock_acquire (struct lock *);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
+void lock_print_stats (void);
+
+/* Readers-writer lock.  Any number of readers may hold it at
+   once, or a single writer.  Writers are preferred: once a writer
+   is waiting, new readers wait until it is done.  The writer
+   holding the lock, or waiting for readers to finish, receives
+   priority donations from the threads waiting behind it. */
+struct rwlock 
+  {
+    struct lock writer;         /* Held by writer or next writer. */
+    unsigned readers;           /* Number of readers holding lock. */
+    unsigned writers;           /* Writers holding or awaiting lock. */
+    unsigned write_cnt;         /* Number of write holds so far. */
+    bool draining;              /* Writer waiting for readers? */
+    struct semaphore drained;   /* Upped when last reader leaves. */
+  };
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+bool rwlock_upgrade (struct rwlock *);
+void rwlock_downgrade (struct rwlock *);
+bool rwlock_held_for_write (const struct rwlock *);
 
 /* Condition variable. */
 struct condition 
   {
-    struct list waiters;        /* List of waiting threads. */
+    struct pqueue waiters;      /* Waiting threads, by priority. */
   };
 
 void cond_init (struct condition *);
@@ -1,16 +1,22 @@
 #include "threads/thread.h"
 #include <debug.h>
+#include <limits.h>
 #include <stddef.h>
 #include <random.h>
+#include <round.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/slab.h"
+#include "threads/smp.h"
 #include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "devices/timer.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #endif
@@ -20,36 +26,93 @@
    of thread.h for details. */
 #define THREAD_MAGIC 0xcd6abf4b
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+/* Number of distinct thread priorities. */
+#define PRI_CNT (PRI_MAX - PRI_MIN + 1)
+
+/* Per-CPU scheduler state.
+
+   The run queue, the idle thread, and the time-slice counter
+   live in a struct cpu rather than in globals, so that the
+   scheduler's code says which CPU's state it touches.  Each CPU's
+   run queue holds its processes in THREAD_READY state, that is,
+   processes that are ready to run but not actually running.
+   There is one FIFO list per priority level, and bit P of
+   ready_bitmap is set iff ready_queues[P - PRI_MIN] is nonempty,
+   so the highest runnable priority is found with a bit scan
+   instead of sorting a single list on every context switch.
+   Real-time threads with budget left wait in edf_queue instead,
+   in order of deadline, and run before any thread in
+   ready_queues; see edf_list.
+
+   There is one struct cpu for each CPU that smp_start() brings
+   up.  The run queues are protected by turning interrupts off,
+   which on more than one CPU also takes the kernel lock (see
+   interrupt.c), so a CPU may look at and change every CPU's run
+   queue.  A thread that becomes ready goes to the run queue of
+   an idle CPU if there is one (see choose_cpu()), and a CPU
+   whose own run queue is empty steals a thread from the longest
+   run queue of another CPU before it goes idle.  Pinned threads,
+   which run user code, stay on the boot CPU; see thread_pin(). */
+struct cpu 
+  {
+    struct thread *idle_thread; /* This CPU's idle thread. */
+    struct thread *running;     /* Thread this CPU is running. */
+    unsigned thread_ticks;      /* # of timer ticks since last yield. */
+    int64_t ticks;              /* # of timer ticks, on an AP. */
+
+    /* Run queue. */
+    struct list ready_queues[PRI_CNT];
+    struct list edf_queue;      /* Real-time threads, by deadline. */
+    uint32_t ready_bitmap[DIV_ROUND_UP (PRI_CNT, 32)];
+    int ready_cnt;              /* # of threads in the run queue. */
+    int pinned_cnt;             /* # of those that are pinned. */
+  };
+
+static struct cpu cpus[CPU_MAX];
+
+/* Number of CPUs scheduling threads.  This is initialized here,
+   rather than in thread_init(), because interrupt.c asks which
+   CPU it is on even before then. */
+static unsigned cpu_cnt = 1;
 
-/////////////////////////////////////
-// prj1(wait) - sungmin oh - start //
-// define wait queue
-static struct list wait_list;
-// thread.c is not importe by any other.
-// so we can not directly access wait_list.
-// we need indirect way to access wait_list.
-struct list* wait_list_ptr(void){
-  return &wait_list;
-} 
-// prj1(wait) - sungmin oh - end //
-// ////////////////////////////////
+/* Set once thread_prepare_ap() has been called.  Until then
+   only the boot CPU runs, and cpu_self() need not look at the
+   running thread, which may not be set up yet. */
+static bool aps_prepared;
 
+static struct thread *running_thread (void);
+
+/* Returns the CPU we are running on.  Interrupts must be off, or
+   the running thread must be one that does not move between
+   CPUs, such as an idle thread or a pinned thread. */
+static inline struct cpu *
+cpu_self (void) 
+{
+  return aps_prepared ? running_thread ()->running_on : &cpus[0];
+}
 
 /* List of all processes.  Processes are added to this list
    when they are first scheduled and removed when they exit. */
 static struct list all_list;
 
-/* Idle thread. */
-static struct thread *idle_thread;
-
 /* Initial thread, the thread running init.c:main(). */
 static struct thread *initial_thread;
 
-/* Lock used by allocate_tid(). */
-static struct lock tid_lock;
+/* Recycled thread pages.  A dying thread's page is kept here,
+   up to THREAD_CACHE_SIZE of them, instead of going back to the
+   page allocator, so that thread_create() can reuse it without
+   scanning the allocator's bitmap or zeroing the whole page.
+   init_thread() clears the struct thread and alloc_frame()
+   clears the stack frames it makes, and the rest of the stack is
+   never read before it is written.  Interrupts must be off to
+   access the cache. */
+#define THREAD_CACHE_SIZE 16
+static struct thread *thread_cache[THREAD_CACHE_SIZE];
+static size_t thread_cache_cnt;
+
+/* Child process records, allocated by thread_create() and freed
+   by the process code. */
+struct kmem_cache *child_process_cache;
 
 
 
@@ -65,20 +128,76 @@ struct kernel_thread_frame
 static long long idle_ticks;    /* # of timer ticks spent idle. */
 static long long kernel_ticks;  /* # of timer ticks in kernel threads. */
 static long long user_ticks;    /* # of timer ticks in user programs. */
-
-/* Scheduling. */
-#define TIME_SLICE 4            /* # of timer ticks to give each thread. */
-static unsigned thread_ticks;   /* # of timer ticks since last yield. */
+static long long voluntary_switches;   /* # of switches away from a
+                                          thread that blocked. */
+static long long involuntary_switches; /* # of switches away from a
+                                          thread that was preempted. */
+static long long wake_batches;  /* # of wake batches finished... */
+static long long batch_wakeups; /* ...threads they woke... */
+static long long batch_preempts; /* ...# that preempted the waker... */
+static long long batch_deferrals; /* ...and # that left it to later. */
+static long long steals;        /* # of threads stolen from another
+                                   CPU's run queue. */
+
+/* Default # of timer ticks to give each thread before preempting
+   it in favor of another thread of equal or higher priority.
+   Controlled by kernel command-line option "-ts=TICKS" and
+   overridden per thread by thread_set_time_slice(). */
+unsigned thread_time_slice = TIME_SLICE;
 
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* Advanced scheduler.  See [4.4BSD] and the Pintos reference
+   guide, appendix B "4.4BSD Scheduler". */
+#define PRI_UPDATE_TICKS 4      /* Recompute priority every 4 ticks. */
+static fixed_point load_avg;    /* System load average. */
+
+/* Once per second every thread's recent_cpu decays by a
+   coefficient derived from load_avg.  Running and ready threads
+   are decayed eagerly, because their priorities must be current
+   for scheduling.  A blocked thread is decayed lazily instead:
+   it waits on decay_lists[E % DECAY_HISTORY], where E is the
+   second in which it was last decayed, and applies the
+   coefficients it missed from decay_coefs[] when it is
+   unblocked.  Each second only the one list whose threads are
+   about to outlive the coefficient history is brought up to
+   date, so the per-second pass touches the running and ready
+   threads plus, on average, 1/DECAY_HISTORY of the blocked
+   ones. */
+#define DECAY_HISTORY 64
+static int decay_seconds;       /* # of per-second decays so far. */
+static fixed_point decay_coefs[DECAY_HISTORY];
+static struct list decay_lists[DECAY_HISTORY];
+
+/* Earliest-deadline-first scheduling class.  A thread that calls
+   thread_set_realtime() reserves RUNTIME ticks of CPU time in
+   every PERIOD ticks, to be received within DEADLINE ticks of
+   the start of the period.  While it has budget left in its
+   current period, it waits in its CPU's edf_queue and runs ahead
+   of every other thread, whatever their priorities; among
+   real-time threads, the one with the earliest deadline runs.
+   thread_tick() charges the running thread's budget, and a
+   thread that uses it all up falls back to ordinary priority
+   scheduling until its next period starts, so that a thread
+   overrunning its reservation cannot take time reserved by
+   others.
+
+   Admission control keeps the sum of RUNTIME / DEADLINE over all
+   real-time threads at or below EDF_BANDWIDTH_MAX.  Under EDF a
+   sum of at most 1 is enough for every deadline to be met; the
+   rest is left for the other threads. */
+#define EDF_BANDWIDTH_MAX 900   /* Parts per thousand of the CPU. */
+static struct list edf_list;    /* All real-time threads. */
+static int edf_bandwidth;       /* Sum of their bandwidths. */
+
 static void kernel_thread (thread_func *, void *aux);
 
 static void idle (void *aux UNUSED);
-static struct thread *running_thread (void);
+static void idle_loop (void) NO_RETURN;
+static bool idle_has_work (struct cpu *);
 static struct thread *next_thread_to_run (void);
 static void init_thread (struct thread *, const char *name, int priority);
 static bool is_thread (struct thread *) UNUSED;
@@ -86,6 +205,37 @@ static void *alloc_frame (struct thread *, size_t size);
 static void schedule (void);
 void thread_schedule_tail (struct thread *prev);
 static tid_t allocate_tid (void);
+static struct thread *thread_page_get (void);
+static void thread_page_put (struct thread *);
+static palloc_reclaim_func thread_cache_reclaim;
+static void ready_queue_push (struct cpu *, struct thread *);
+static void ready_queue_remove (struct thread *);
+static struct thread *ready_queue_pop (struct cpu *);
+static int ready_queue_max_priority (struct cpu *);
+static struct cpu *ready_queue_victim (struct cpu *);
+static struct thread *ready_queue_steal (struct cpu *);
+static struct thread *first_unpinned (struct list *);
+static struct cpu *choose_cpu (const struct thread *);
+static void cpu_kick (struct cpu *, const struct thread *);
+static void cpu_kick_idle (struct cpu *);
+static bool is_idle_thread (const struct thread *);
+static int mlfqs_priority (const struct thread *);
+static void mlfqs_park (struct thread *);
+static void mlfqs_unpark (struct thread *);
+static void mlfqs_update_second (void);
+static void record_wait (struct thread *, int64_t ns);
+static void copy_thread_stats (struct thread *, void *aux);
+struct thread_stats_copy;
+static void print_thread_stats (const struct thread_stats_copy *);
+static bool ready_queue_preempts (struct cpu *, const struct thread *,
+                                  bool ties);
+static bool thread_outranks (const struct thread *, const struct thread *);
+static bool edf_active (const struct thread *);
+static list_less_func edf_deadline_less;
+static int edf_thread_bandwidth (int runtime, int deadline);
+static void edf_leave (struct thread *);
+static void edf_tick (struct thread *);
+static void edf_new_periods (void);
 
 
 /* Initializes the threading system by transforming the code
@@ -93,7 +243,7 @@ static tid_t allocate_tid (void);
    general and it is possible in this case only because loader.S
    was careful to put the bottom of the stack at a page boundary.
 
-   Also initializes the run queue and the tid lock.
+   Also initializes the run queues.
 
    After calling this function, be sure to initialize the page
    allocator before trying to create any threads with
@@ -106,23 +256,30 @@ thread_init (void)
 {
   ASSERT (intr_get_level () == INTR_OFF);
 
-  lock_init (&tid_lock);
-  list_init (&ready_list);
-  list_init (&all_list);
+  int i;
 
+  for (i = 0; i < CPU_MAX; i++) 
+    {
+      int pri;
 
-  /////////////////////////////////////
-  // prj1(wait) - sungmin oh - start //
-  // initiallize wait list
-  list_init (&wait_list);
-  // prj1(wait) - sungmin oh - end //
-  ///////////////////////////////////
+      for (pri = 0; pri < PRI_CNT; pri++)
+        list_init (&cpus[i].ready_queues[pri]);
+      list_init (&cpus[i].edf_queue);
+    }
+  for (i = 0; i < DECAY_HISTORY; i++)
+    list_init (&decay_lists[i]);
+  list_init (&edf_list);
+  list_init (&all_list);
 
   /* Set up a thread structure for the running thread. */
   initial_thread = running_thread ();
   init_thread (initial_thread, "main", PRI_DEFAULT);
+  if (thread_mlfqs)
+    mlfqs_unpark (initial_thread);
   initial_thread->status = THREAD_RUNNING;
   initial_thread->tid = allocate_tid ();
+  initial_thread->running_on = &cpus[0];
+  cpus[0].running = initial_thread;
 }
 
 /* Starts preemptive thread scheduling by enabling interrupts.
@@ -130,50 +287,312 @@ thread_init (void)
 void
 thread_start (void) 
 {
-  /* Create the idle thread. */
   struct semaphore idle_started;
+
+  /* thread_create() allocates a child_process record for every
+     thread, starting with the idle thread. */
+  child_process_cache = kmem_cache_create ("child_process",
+                                           sizeof (struct child_process),
+                                           NULL);
+
+  /* Create the idle thread. */
   sema_init (&idle_started, 0);
   thread_create ("idle", PRI_MIN, idle, &idle_started);
 
+  /* Let the page allocator take back recycled thread pages. */
+  palloc_set_reclaim (0, thread_cache_reclaim);
+
   /* Start preemptive thread scheduling. */
   intr_enable ();
 
-  /* Wait for the idle thread to initialize idle_thread. */
+  /* Wait for the idle thread to initialize cpu_self ()->idle_thread. */
   sema_down (&idle_started);
 }
 
+/* Makes the idle thread for application processor CPU, which
+   must be the next one to start, and returns it.  smp_start()
+   starts the processor on the idle thread's stack, and the
+   processor then calls thread_start_ap(). */
+struct thread *
+thread_prepare_ap (unsigned cpu) 
+{
+  struct cpu *c = &cpus[cpu];
+  enum intr_level old_level;
+  struct thread *t;
+  char name[16];
+
+  ASSERT (cpu == cpu_cnt && cpu < CPU_MAX);
+
+  t = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+  snprintf (name, sizeof name, "idle%u", cpu);
+  init_thread (t, name, PRI_MIN);
+  t->tid = allocate_tid ();
+
+  old_level = intr_disable ();
+  if (thread_mlfqs)
+    mlfqs_unpark (t);
+  t->status = THREAD_RUNNING;
+  t->running_on = c;
+  c->idle_thread = t;
+  c->running = t;
+  aps_prepared = true;
+  intr_set_level (old_level);
+
+  return t;
+}
+
+/* Starts scheduling threads on the application processor we
+   are running on, which is running the idle thread made for it
+   by thread_prepare_ap().  Sets *STARTED to true once other
+   CPUs may give it threads to run.  Interrupts must be off. */
+void
+thread_start_ap (volatile bool *started) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (cpu_self () == &cpus[cpu_cnt]);
+
+  cpu_cnt++;
+  *started = true;
+  idle_loop ();
+}
+
+/* Returns the number of the CPU we are running on, where the
+   boot CPU is 0.  Interrupts must be off, or the running thread
+   must be one that does not move between CPUs. */
+unsigned
+thread_cpu_id (void) 
+{
+  return cpu_self () - cpus;
+}
+
+/* Returns the number of CPUs scheduling threads. */
+unsigned
+thread_cpu_cnt (void) 
+{
+  return cpu_cnt;
+}
+
+/* Pins the running thread to the boot CPU, moving it there if
+   it is running elsewhere.  A thread that runs user code must
+   be pinned first: only the boot CPU has a TSS to take it back
+   into the kernel, and only the boot CPU's TLB ever holds user
+   mappings, so that changing a page table never needs another
+   CPU's TLB flushed. */
+void
+thread_pin (void) 
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  cur->pinned = true;
+  if (cpu_self () != &cpus[0])
+    thread_yield ();
+  intr_set_level (old_level);
+}
+
 /* Called by the timer interrupt handler at each timer tick.
    Thus, this function runs in an external interrupt context. */
 void
 thread_tick (void) 
 {
   struct thread *t = thread_current ();
+  struct cpu *c = cpu_self ();
+  bool preempt;
 
   /* Update statistics. */
-  if (t == idle_thread)
+  if (is_idle_thread (t))
     idle_ticks++;
 #ifdef USERPROG
   else if (t->pagedir != NULL)
-    user_ticks++;
+    {
+      user_ticks++;
+      t->user_ticks++;
+    }
 #endif
   else
-    kernel_ticks++;
+    {
+      kernel_ticks++;
+      t->kernel_ticks++;
+    }
 
-  /* Enforce preemption. */
-  /* oroginal code 
-   *
-  if (++thread_ticks >= TIME_SLICE)
+  /* Each CPU takes its own ticks, but work done once per tick
+     for the whole system is left to the boot CPU, whose ticks
+     drive timer_ticks(). */
+  if (thread_mlfqs)
+    {
+      int64_t now = c == &cpus[0] ? timer_ticks () : ++c->ticks;
+
+      if (!is_idle_thread (t))
+        t->recent_cpu = fp_add_int (t->recent_cpu, 1);
+
+      if (c == &cpus[0] && now % TIMER_FREQ == 0)
+        mlfqs_update_second ();
+      else if (now % PRI_UPDATE_TICKS == 0 && !is_idle_thread (t))
+        {
+          /* Between per-second updates only the running thread's
+             recent_cpu changes, so only its priority can. */
+          t->priority = mlfqs_priority (t);
+          if (ready_queue_preempts (c, t, false))
+            intr_yield_on_return ();
+        }
+    }
+
+  if (!list_empty (&edf_list))
+    {
+      edf_tick (t);
+      if (c == &cpus[0])
+        edf_new_periods ();
+    }
+
+  /* Enforce preemption.  A real-time thread that has started a
+     new period may outrank us at any tick.  At the end of our
+     time slice, there is no point in yielding if no other thread
+     may run in our place. */
+  if (++c->thread_ticks >= (t->time_slice != 0 ? t->time_slice
+                                               : thread_time_slice))
+    preempt = ready_queue_preempts (c, t, true);
+  else
+    preempt = ready_queue_preempts (c, t, false);
+  if (preempt)
     intr_yield_on_return ();
-  *
-  */
 }
 
-/* Prints thread statistics. */
+/* A thread's statistics, copied by thread_print_stats(). */
+struct thread_stats_copy
+  {
+    struct sched_stats s;               /* Scheduling statistics. */
+    int edf_runtime;                    /* Real-time reservation, */
+    int edf_deadline;                   /*   if edf_runtime != 0. */
+    int edf_period;
+    unsigned edf_periods;               /* Periods ended. */
+    unsigned edf_misses;                /* Deadlines missed. */
+  };
+
+/* Buffer being filled by copy_thread_stats(). */
+struct thread_stats_buffer
+  {
+    struct thread_stats_copy *copies;   /* Array of copies. */
+    size_t cnt;                         /* Number filled in. */
+    size_t size;                        /* Number of elements. */
+  };
+
+/* Prints thread statistics.  The per-thread statistics are
+   copied with interrupts off and printed afterward, because
+   printf() may sleep on the console lock, and a thread that
+   exited meanwhile would leave thread_foreach() on a freed
+   element. */
 void
 thread_print_stats (void) 
 {
+  struct thread_stats_buffer buf;
+  enum intr_level old_level;
+  size_t i;
+
   printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
           idle_ticks, kernel_ticks, user_ticks);
+  printf ("Thread: %lld voluntary, %lld involuntary context switches\n",
+          voluntary_switches, involuntary_switches);
+  printf ("Thread: %lld wakeups in %lld batches, %lld preempted the waker, "
+          "%lld deferred\n",
+          batch_wakeups, wake_batches, batch_preempts, batch_deferrals);
+  if (cpu_cnt > 1)
+    printf ("Thread: %u CPUs online, %lld threads stolen\n",
+            cpu_cnt, steals);
+
+  /* Threads created after the count is taken are left out. */
+  old_level = intr_disable ();
+  buf.size = list_size (&all_list);
+  intr_set_level (old_level);
+  buf.copies = malloc (buf.size * sizeof *buf.copies);
+  if (buf.copies == NULL)
+    return;
+  buf.cnt = 0;
+  old_level = intr_disable ();
+  thread_foreach (copy_thread_stats, &buf);
+  intr_set_level (old_level);
+
+  for (i = 0; i < buf.cnt; i++)
+    print_thread_stats (&buf.copies[i]);
+  free (buf.copies);
+}
+
+/* Copies the statistics of thread T into the thread_stats_buffer
+   AUX, if there is room, for thread_print_stats(). */
+static void
+copy_thread_stats (struct thread *t, void *aux) 
+{
+  struct thread_stats_buffer *buf = aux;
+  struct thread_stats_copy *c;
+
+  if (buf->cnt >= buf->size)
+    return;
+  c = &buf->copies[buf->cnt++];
+  thread_get_stats (t, &c->s);
+  c->edf_runtime = t->edf_runtime;
+  c->edf_deadline = t->edf_deadline;
+  c->edf_period = t->edf_period;
+  c->edf_periods = t->edf_periods;
+  c->edf_misses = t->edf_misses;
+}
+
+/* Prints the thread statistics in C, for thread_print_stats(). */
+static void
+print_thread_stats (const struct thread_stats_copy *c) 
+{
+  const struct sched_stats *s = &c->s;
+  int b;
+
+  printf ("Thread %d (%s): %u user, %u kernel ticks, "
+          "scheduled %u times, %u voluntary, %u involuntary switches\n",
+          s->tid, s->name, s->user_ticks, s->kernel_ticks, s->scheduled,
+          s->voluntary_switches, s->involuntary_switches);
+  printf ("Thread %d (%s): run-queue waits:", s->tid, s->name);
+  for (b = 0; b < SCHED_WAIT_BUCKETS; b++)
+    if (s->wait_hist[b] != 0) 
+      {
+        if (b < SCHED_WAIT_BUCKETS - 1)
+          printf (" <%uus %u", 2u << b, s->wait_hist[b]);
+        else
+          printf (" >=%uus %u", 1u << b, s->wait_hist[b]);
+      }
+  printf ("\n");
+  if (c->edf_runtime != 0)
+    printf ("Thread %d (%s): real-time %d/%d/%d ticks, "
+            "%u periods, %u missed deadlines\n",
+            s->tid, s->name, c->edf_runtime, c->edf_deadline, c->edf_period,
+            c->edf_periods, c->edf_misses);
+}
+
+/* Copies thread T's scheduling statistics into *S. */
+void
+thread_get_stats (const struct thread *t, struct sched_stats *s) 
+{
+  enum intr_level old_level = intr_disable ();
+
+  ASSERT (is_thread ((struct thread *) t));
+
+  s->tid = t->tid;
+  strlcpy (s->name, t->name, sizeof s->name);
+  s->user_ticks = t->user_ticks;
+  s->kernel_ticks = t->kernel_ticks;
+  s->scheduled = t->scheduled;
+  s->voluntary_switches = t->voluntary_switches;
+  s->involuntary_switches = t->involuntary_switches;
+  memcpy (s->wait_hist, t->wait_hist, sizeof s->wait_hist);
+  intr_set_level (old_level);
+}
+
+/* Adds a run-queue wait of NS nanoseconds to T's histogram. */
+static void
+record_wait (struct thread *t, int64_t ns) 
+{
+  uint32_t us = ns >= 1000 * (int64_t) UINT32_MAX ? UINT32_MAX : ns / 1000;
+  int b = us > 1 ? 31 - __builtin_clz (us) : 0;
+
+  if (b >= SCHED_WAIT_BUCKETS)
+    b = SCHED_WAIT_BUCKETS - 1;
+  t->wait_hist[b]++;
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -199,18 +618,27 @@ thread_create (const char *name, int priority,
   struct kernel_thread_frame *kf;
   struct switch_entry_frame *ef;
   struct switch_threads_frame *sf;
+  enum intr_level old_level;
+  bool preempt;
   tid_t tid;
 
   ASSERT (function != NULL);
 
   /* Allocate thread. */
-  t = palloc_get_page (PAL_ZERO);
+  t = thread_page_get ();
   if (t == NULL) // t is new thread! maybe... child!
     return TID_ERROR;
 
   /* Initialize thread. */
   init_thread (t, name, priority);
   tid = t->tid = allocate_tid ();
+  if (thread_mlfqs)
+    {
+      /* Inherit niceness and recent CPU usage from the parent. */
+      t->nice = thread_current ()->nice;
+      t->recent_cpu = thread_current ()->recent_cpu;
+      t->priority = priority = mlfqs_priority (t);
+    }
 
   /* Stack frame for kernel_thread(). */
   kf = alloc_frame (t, sizeof *kf);
@@ -234,7 +662,7 @@ thread_create (const char *name, int priority,
 	//add to child list
 	
     //printf("child info update\n");
-	struct child_process * cp = malloc(sizeof(struct child_process));
+	struct child_process * cp = kmem_cache_alloc (child_process_cache);
 	cp -> tid = t -> tid;
     cp -> load = false;
     cp-> not_load = true;
@@ -244,19 +672,15 @@ thread_create (const char *name, int priority,
 
 
 	//
-  /* Add to run queue. */
+  /* Add to run queue, and let the new thread run at once if it
+     outranks us.  Once T is ready it may run and exit, so decide
+     before interrupts are back on. */
+  old_level = intr_disable ();
   thread_unblock (t);
-
-  /////////////////////////////////////////
-  // prj1(priority) - sungmin oh - start //
-  // when the new thread is created
-  // if priority of this new thread is higher than that of current thread,
-  // than preemption occur
-  if (priority >= (thread_current()->priority)){
-    thread_yield();
-  }
-  // prj1(priority) - sungmin oh - end //
-  ///////////////////////////////////////
+  preempt = thread_preempts (t);
+  intr_set_level (old_level);
+  if (preempt)
+    thread_yield ();
 
   return tid;
 }
@@ -274,6 +698,8 @@ thread_block (void)
   ASSERT (intr_get_level () == INTR_OFF);
 
   thread_current ()->status = THREAD_BLOCKED;
+  if (thread_mlfqs && !is_idle_thread (thread_current ()))
+    mlfqs_park (thread_current ());
   schedule ();
 }
 
@@ -284,29 +710,118 @@ thread_block (void)
    This function does not preempt the running thread.  This can
    be important: if the caller had disabled interrupts itself,
    it may expect that it can atomically unblock a thread and
-   update other data. */
+   update other data.  T may go to another CPU, which is
+   interrupted if T should run there at once.  On return, T will
+   not have run yet if interrupts were off. */
 void
 thread_unblock (struct thread *t) 
 {
   enum intr_level old_level;
+  struct cpu *c;
 
   ASSERT (is_thread (t));
 
   old_level = intr_disable ();
   ASSERT (t->status == THREAD_BLOCKED);
-  /////////////////////////////////////////
-  // prj1(priority) - sungmin oh - start //
-  list_insert_ordered(&ready_list, &t->elem, (list_less_func*)&higher_priority, NULL);
-  // prj1(priority) - sungmin oh - end //
-  ///////////////////////////////////////
-  
-  /* original code
-   */
-  //list_push_back (&ready_list, &t->elem);
+  if (thread_mlfqs)
+    {
+      mlfqs_unpark (t);
+      t->priority = mlfqs_priority (t);
+    }
   t->status = THREAD_READY;
+  t->ready_since = timer_now_ns ();
+  c = choose_cpu (t);
+  ready_queue_push (c, t);
+  cpu_kick (c, t);
+  intr_set_level (old_level);
+}
+
+/* Initializes BATCH as an empty set of woken threads.
+
+   Waking several threads one at a time, and yielding after each
+   one that outranks the running thread, costs a context switch
+   per thread, and each woken thread usually finds that it must
+   wait for the waker anyway, for example to reacquire a lock it
+   holds.  Instead, a waker can add each thread to a batch with
+   wake_batch_add(), which unblocks it without preempting, and
+   then call wake_batch_finish() to yield at most once, to the
+   highest-ranking thread woken, or not at all if the waker is
+   about to release what the woken threads need. */
+void
+wake_batch_init (struct wake_batch *batch) 
+{
+  batch->best = NULL;
+  batch->cnt = 0;
+}
+
+/* Unblocks T, which must be blocked, as part of BATCH.  Does not
+   preempt the running thread. */
+void
+wake_batch_add (struct wake_batch *batch, struct thread *t) 
+{
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  thread_unblock (t);
+  if (batch->best == NULL || thread_outranks (t, batch->best))
+    batch->best = t;
+  batch->cnt++;
+  intr_set_level (old_level);
+}
+
+/* Finishes BATCH.  If the highest-ranking thread it woke should
+   run in place of the running thread, and YIELD is true, yields
+   the CPU, or in an interrupt handler, yields on return from the
+   interrupt.  If YIELD is false, the caller must soon call
+   thread_check_preempt() instead, as lock_release() does.  The
+   threads in BATCH must not have had a chance to run since they
+   were added, so the caller should keep interrupts off from the
+   first wake_batch_add() until this call. */
+void
+wake_batch_finish (struct wake_batch *batch, bool yield) 
+{
+  enum intr_level old_level;
+
+  if (batch->cnt == 0)
+    return;
+
+  old_level = intr_disable ();
+  wake_batches++;
+  batch_wakeups += batch->cnt;
+  if (thread_preempts (batch->best)) 
+    {
+      if (!yield)
+        batch_deferrals++;
+      else if (intr_context ())
+        {
+          batch_preempts++;
+          intr_yield_on_return ();
+        }
+      else
+        {
+          batch_preempts++;
+          thread_yield ();
+        }
+    }
+  intr_set_level (old_level);
+}
+
+/* Yields the CPU, or in an interrupt handler, yields on return
+   from the interrupt, if a thread in the run queue should run in
+   place of the running thread. */
+void
+thread_check_preempt (void) 
+{
+  enum intr_level old_level = intr_disable ();
+
+  if (ready_queue_preempts (cpu_self (), thread_current (), false)) 
+    {
+      if (intr_context ())
+        intr_yield_on_return ();
+      else
+        thread_yield ();
+    }
   intr_set_level (old_level);
-  /*
-  */
 }
 
 /* Returns the name of the running thread. */
@@ -357,6 +872,8 @@ thread_exit (void)
      and schedule another process.  That process will destroy us
      when it calls thread_schedule_tail(). */
   intr_disable ();
+  if (thread_current ()->edf_runtime != 0)
+    edf_leave (thread_current ());
   list_remove (&thread_current()->allelem);
   thread_current ()->status = THREAD_DYING;
   schedule ();
@@ -374,15 +891,15 @@ thread_yield (void)
   ASSERT (!intr_context ());
 
   old_level = intr_disable ();
-  if (cur != idle_thread) {
-    list_insert_ordered(&ready_list, &cur->elem, (list_less_func*)&higher_priority, NULL);
-    /* original code
-     *
-    list_push_back (&ready_list, &cur->elem);
-    *
-    */
-  }
   cur->status = THREAD_READY;
+  if (!is_idle_thread (cur)) 
+    {
+      struct cpu *c = cur->pinned ? &cpus[0] : cpu_self ();
+
+      cur->ready_since = timer_now_ns ();
+      ready_queue_push (c, cur);
+      cpu_kick (c, cur);
+    }
   schedule ();
   intr_set_level (old_level);
 }
@@ -411,33 +928,200 @@ thread_set_priority (int new_priority)
   /////////////////////////////////////////
   // prj1(priority) - sungmin oh - start //
   struct thread* cur = thread_current();
-  // this function set original priority
-  cur->original_priority = new_priority;
-  // but in case current thread didn't get donation or current priority is lower than new_priority
-  // cur->priority has to be modified too. and current priority is no more not donated priority.
-  if(!cur->donated || (cur->priority < new_priority) ){
-    cur->priority = new_priority;
-    cur->donated = false;
-  }
+  enum intr_level old_level;
+
+  // the advanced scheduler computes priorities itself
+  if (thread_mlfqs)
+    return;
+
+  // this function sets the base priority. priority donated
+  // through held locks still applies on top of it.
+  cur->base_priority = new_priority;
+  thread_update_priority (cur);
   /* original code
    *
    thread_current ()->priority = new_priority;
    *
    */
 
-  // check whether there exist higher priority thread in ready list
+  // check whether there exist higher priority thread in ready queues
   // if so, thread_yield has to be called 
-  if(!list_empty(&ready_list)){
-    list_sort(&ready_list, higher_priority, NULL);
-    struct thread* next_thread = list_entry(list_front(&ready_list), struct thread, elem);
-    if(next_thread->priority > cur->priority){ 
-      thread_yield();
-    }
-  }
+  old_level = intr_disable ();
+  if (ready_queue_preempts (cpu_self (), cur, false))
+    thread_yield ();
+  intr_set_level (old_level);
   // prj1(priority) - sungmin oh - end //
   ///////////////////////////////////////
 }
 
+/* Recomputes T's effective priority as the higher of its base
+   priority and the highest priority donated to it through the
+   locks it holds. */
+void
+thread_update_priority (struct thread *t) 
+{
+  int priority = t->base_priority;
+
+  if (!heap_empty (&t->held_locks)) 
+    {
+      struct lock *lock = heap_entry (heap_max (&t->held_locks),
+                                      struct lock, elem);
+      if (lock->max_priority > priority)
+        priority = lock->max_priority;
+    }
+  thread_set_effective_priority (t, priority);
+}
+
+/* Sets the effective priority of thread T to PRIORITY, as done
+   by priority donation and its rollback.  If T is in the run
+   queue, it is moved to the queue for its new priority; if it is
+   waiting on a semaphore or condition variable, it is moved to
+   its new place in that wait queue.  Does not preempt the
+   running thread. */
+void
+thread_set_effective_priority (struct thread *t, int priority)
+{
+  enum intr_level old_level;
+
+  ASSERT (is_thread (t));
+  ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
+
+  old_level = intr_disable ();
+  if (t->status == THREAD_READY && t->priority != priority)
+    {
+      struct cpu *c = t->cpu;
+
+      ready_queue_remove (t);
+      t->priority = priority;
+      ready_queue_push (c, t);
+      cpu_kick (c, t);
+    }
+  else
+    t->priority = priority;
+  if (t->wait_queue != NULL)
+    pqueue_set_priority (t->wait_queue, &t->wait_elem, priority);
+  intr_set_level (old_level);
+}
+
+/* Sets the current thread's time slice to TICKS timer ticks.  A
+   value of 0 restores the default set by "-ts". */
+void
+thread_set_time_slice (unsigned ticks)
+{
+  thread_current ()->time_slice = ticks;
+}
+
+/* Returns the current thread's time slice in timer ticks. */
+unsigned
+thread_get_time_slice (void)
+{
+  struct thread *cur = thread_current ();
+
+  return cur->time_slice != 0 ? cur->time_slice : thread_time_slice;
+}
+
+/* Makes the running thread a real-time thread that needs RUNTIME
+   timer ticks of CPU time in every PERIOD ticks, within DEADLINE
+   ticks of the start of each period, where 0 < RUNTIME <=
+   DEADLINE <= PERIOD.  Its first period starts now.  A RUNTIME
+   of 0 makes it an ordinary thread again.
+
+   Returns false, leaving the thread as it was, if the arguments
+   are invalid or if admitting the thread would overcommit the
+   CPU.  See edf_list for details. */
+bool
+thread_set_realtime (int runtime, int deadline, int period) 
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  int bandwidth = 0;
+  int old_bandwidth;
+
+  if (runtime != 0) 
+    {
+      if (runtime < 0 || deadline < runtime || period < deadline
+          || runtime > INT_MAX / 1000)
+        return false;
+      bandwidth = edf_thread_bandwidth (runtime, deadline);
+    }
+
+  old_level = intr_disable ();
+  old_bandwidth = (cur->edf_runtime != 0
+                   ? edf_thread_bandwidth (cur->edf_runtime,
+                                           cur->edf_deadline)
+                   : 0);
+  if (edf_bandwidth - old_bandwidth + bandwidth > EDF_BANDWIDTH_MAX) 
+    {
+      intr_set_level (old_level);
+      return false;
+    }
+
+  if (cur->edf_runtime != 0)
+    edf_leave (cur);
+  if (runtime != 0) 
+    {
+      cur->edf_runtime = runtime;
+      cur->edf_deadline = deadline;
+      cur->edf_period = period;
+      cur->edf_budget = runtime;
+      cur->edf_release = timer_ticks ();
+      cur->edf_abs_deadline = cur->edf_release + deadline;
+      cur->edf_met = false;
+      list_push_back (&edf_list, &cur->edf_elem);
+      edf_bandwidth += bandwidth;
+    }
+  else if (ready_queue_preempts (cpu_self (), cur, false))
+    thread_yield ();
+  intr_set_level (old_level);
+  return true;
+}
+
+/* Ends the running real-time thread's work for its current
+   period and sleeps until its next period starts.  Returns true
+   if the work was done by the period's deadline, false if it was
+   late. */
+bool
+thread_wait_period (void) 
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  int64_t now, next;
+  bool met;
+
+  ASSERT (cur->edf_runtime != 0);
+
+  old_level = intr_disable ();
+  now = timer_ticks ();
+  met = now <= cur->edf_abs_deadline;
+  cur->edf_met = met;
+  next = cur->edf_release + cur->edf_period;
+  intr_set_level (old_level);
+
+  if (next > now)
+    timer_sleep (next - now);
+  return met;
+}
+
+/* Returns true if thread T, which is ready to run, is in this
+   CPU's run queue and should run in place of the running thread.
+   See thread_outranks().  Interrupts must be off. */
+bool
+thread_preempts (const struct thread *t) 
+{
+  return t->cpu == cpu_self () && thread_outranks (t, thread_current ());
+}
+
+/* Returns true if thread A should run ahead of thread B: if A is
+   a real-time thread with budget left and an earlier deadline,
+   or if neither is such a thread and A has a higher priority. */
+static bool
+thread_outranks (const struct thread *a, const struct thread *b) 
+{
+  if (edf_active (b))
+    return edf_active (a) && a->edf_abs_deadline < b->edf_abs_deadline;
+  return edf_active (a) || a->priority > b->priority;
+}
+
 /* Returns the current thread's priority. */
 int
 thread_get_priority (void) 
@@ -445,75 +1129,125 @@ thread_get_priority (void)
   return thread_current ()->priority;
 }
 
-/* Sets the current thread's nice value to NICE. */
+/* Sets the current thread's nice value to NICE and recalculates
+   its priority, yielding if it no longer has the highest
+   priority. */
 void
-thread_set_nice (int nice UNUSED) 
+thread_set_nice (int nice) 
 {
-  /* Not yet implemented. */
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  ASSERT (NICE_MIN <= nice && nice <= NICE_MAX);
+
+  old_level = intr_disable ();
+  cur->nice = nice;
+  if (thread_mlfqs)
+    {
+      cur->priority = mlfqs_priority (cur);
+      if (ready_queue_preempts (cpu_self (), cur, false))
+        thread_yield ();
+    }
+  intr_set_level (old_level);
 }
 
 /* Returns the current thread's nice value. */
 int
 thread_get_nice (void) 
 {
-  /* Not yet implemented. */
-  return 0;
+  return thread_current ()->nice;
 }
 
 /* Returns 100 times the system load average. */
 int
 thread_get_load_avg (void) 
 {
-  /* Not yet implemented. */
-  return 0;
+  enum intr_level old_level = intr_disable ();
+  int load_avg_100 = fp_round (fp_mul_int (load_avg, 100));
+  intr_set_level (old_level);
+  return load_avg_100;
 }
 
 /* Returns 100 times the current thread's recent_cpu value. */
 int
 thread_get_recent_cpu (void) 
 {
-  /* Not yet implemented. */
-  return 0;
+  enum intr_level old_level = intr_disable ();
+  int recent_cpu_100 = fp_round (fp_mul_int (thread_current ()->recent_cpu,
+                                             100));
+  intr_set_level (old_level);
+  return recent_cpu_100;
 }
 
 /* Idle thread.  Executes when no other thread is ready to run.
 
    The idle thread is initially put on the ready list by
    thread_start().  It will be scheduled once initially, at which
-   point it initializes idle_thread, "up"s the semaphore passed
-   to it to enable thread_start() to continue, and immediately
-   blocks.  After that, the idle thread never appears in the
+   point it records itself as its CPU's idle thread, "up"s the
+   semaphore passed to it to enable thread_start() to continue,
+   and immediately blocks.  After that, the idle thread never appears in the
    ready list.  It is returned by next_thread_to_run() as a
    special case when the ready list is empty. */
 static void
 idle (void *idle_started_ UNUSED) 
 {
   struct semaphore *idle_started = idle_started_;
-  idle_thread = thread_current ();
+  cpu_self ()->idle_thread = thread_current ();
   sema_up (idle_started);
 
+  intr_disable ();
+  idle_loop ();
+}
+
+/* Body of every CPU's idle thread.  Interrupts must be off. */
+static void
+idle_loop (void) 
+{
+  struct cpu *self = cpu_self ();
+
   for (;;) 
     {
       /* Let someone else run. */
-      intr_disable ();
+      ASSERT (intr_get_level () == INTR_OFF);
       thread_block ();
 
-      /* Re-enable interrupts and wait for the next one.
+      /* Use the spare time to refill the page allocator's caches
+         of zeroed pages, a page at a time, until they are full
+         or another thread becomes ready.  The check for work
+         reads other CPUs' run queues without the kernel lock,
+         which is good enough for a hint. */
+      intr_enable ();
+      while (!idle_has_work (self) && palloc_zero_idle ())
+        continue;
+      intr_disable ();
+      if (idle_has_work (self))
+        continue;
+
+      /* If no timer work is due soon, stop the periodic timer
+         interrupt until there is.  The other CPUs need the boot
+         CPU's ticks, so this is only done on a uniprocessor. */
+      if (cpu_cnt == 1)
+        timer_idle_enter ();
 
-         The `sti' instruction disables interrupts until the
-         completion of the next instruction, so these two
-         instructions are executed atomically.  This atomicity is
-         important; otherwise, an interrupt could be handled
-         between re-enabling interrupts and waiting for the next
-         one to occur, wasting as much as one clock tick worth of
-         time.
+      /* Re-enable interrupts and wait for the next one. */
+      intr_halt ();
 
-         See [IA32-v2a] "HLT", [IA32-v2b] "STI", and [IA32-v3a]
-         7.11.1 "HLT Instruction". */
-      asm volatile ("sti; hlt" : : : "memory");
+      /* Catch up on ticks skipped while halted, if the interrupt
+         that woke us up was not the timer's. */
+      timer_idle_exit ();
+      intr_disable ();
     }
 }
 
+/* Returns true if SELF, the CPU we are running on, has a thread
+   to run in its own run queue or one to steal from another
+   CPU's. */
+static bool
+idle_has_work (struct cpu *self) 
+{
+  return self->ready_cnt > 0 || ready_queue_victim (self) != NULL;
+}
+
 /* Function used as the basis for a kernel thread. */
 static void
 kernel_thread (thread_func *function, void *aux) 
@@ -565,10 +1299,9 @@ init_thread (struct thread *t, const char *name, int priority)
   /////////////////////////////////////////
   // prj1(donation) - sungmin oh - start //
   // initialize
-  t->locked = NULL;
-  t->original_priority = priority;
-  t->donated = false;
-  list_init(&t->lock_list);
+  t->base_priority = priority;
+  t->waiting_lock = NULL;
+  heap_init (&t->held_locks, lock_priority_less, NULL);
   // prj1(donation) - sungmin oh - end //
   ///////////////////////////////////////
 	
@@ -577,10 +1310,20 @@ init_thread (struct thread *t, const char *name, int priority)
 	list_init(&t->child_list);
 	t->fd = 3;
  	//
+#ifdef USERPROG
+  t->leader = t;
+  lock_init (&t->uthread_lock);
+  list_init (&t->uthreads);
+  cond_init (&t->uthreads_done);
+#endif
+  t->nice = NICE_DEFAULT;
+  t->recent_cpu = 0;
   t->magic = THREAD_MAGIC;
 
   old_level = intr_disable ();
   list_push_back (&all_list, &t->allelem);
+  if (thread_mlfqs)
+    mlfqs_park (t);
   intr_set_level (old_level);
 }
 
@@ -594,44 +1337,583 @@ alloc_frame (struct thread *t, size_t size)
   ASSERT (size % sizeof (uint32_t) == 0);
 
   t->stack -= size;
+  memset (t->stack, 0, size);
   return t->stack;
 }
 
+/* Returns a page for a new thread, from the cache of recycled
+   thread pages if possible.  Only the struct thread at the start
+   of a recycled page, and the stack frames that thread_create()
+   builds, need to be cleared before use; see thread_cache.
+   Returns a null pointer if no page is available. */
+static struct thread *
+thread_page_get (void) 
+{
+  struct thread *t = NULL;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  if (thread_cache_cnt > 0)
+    t = thread_cache[--thread_cache_cnt];
+  intr_set_level (old_level);
+
+  return t != NULL ? t : palloc_get_page (0);
+}
+
+/* Recycles T, the page of a thread that has died, for use by a
+   later thread_create(), or frees it if the cache is full.
+   Interrupts must be off. */
+static void
+thread_page_put (struct thread *t) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
 
-/////////////////////////////////////////
-// prj1(priority) - sungmin oh - start //
-// this function is used as list_less_func type parameter for list_insert_ordered, list_sort, list_max
-bool
-higher_priority(struct list_elem* A, struct list_elem* B, void* aux_unused){
-  struct thread* a = list_entry(A, struct thread, elem);
-  struct thread* b = list_entry(B, struct thread, elem);
+  if (thread_cache_cnt < THREAD_CACHE_SIZE)
+    thread_cache[thread_cache_cnt++] = t;
+  else
+    palloc_free_page (t);
+}
 
-  return a->priority > b->priority;
+/* Reclaim function for kernel pages, called by the page
+   allocator when it runs short: frees every page in the thread
+   cache, whatever PAGE_CNT asks for, and returns how many. */
+static size_t
+thread_cache_reclaim (size_t page_cnt UNUSED) 
+{
+  struct thread *pages[THREAD_CACHE_SIZE];
+  enum intr_level old_level;
+  size_t cnt, i;
+
+  old_level = intr_disable ();
+  cnt = thread_cache_cnt;
+  memcpy (pages, thread_cache, cnt * sizeof *pages);
+  thread_cache_cnt = 0;
+  intr_set_level (old_level);
+
+  for (i = 0; i < cnt; i++)
+    palloc_free_page (pages[i]);
+  return cnt;
+}
+
+
+/* Appends T, which must be in THREAD_READY state, to the run
+   queue for its priority on CPU C, or inserts it into C's
+   real-time queue if it is a real-time thread with budget left.
+   Interrupts must be off. */
+static void
+ready_queue_push (struct cpu *c, struct thread *t)
+{
+  int idx = t->priority - PRI_MIN;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (t->status == THREAD_READY);
+
+  if (edf_active (t))
+    list_insert_ordered (&c->edf_queue, &t->elem, edf_deadline_less, NULL);
+  else 
+    {
+      list_push_back (&c->ready_queues[idx], &t->elem);
+      c->ready_bitmap[idx / 32] |= 1u << (idx % 32);
+    }
+  c->ready_cnt++;
+  if (t->pinned)
+    c->pinned_cnt++;
+  t->cpu = c;
+}
+
+/* Removes T from the run queue it is in on the CPU it is queued
+   on.  Interrupts must be off. */
+static void
+ready_queue_remove (struct thread *t)
+{
+  struct cpu *c = t->cpu;
+  int idx = t->priority - PRI_MIN;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (t->status == THREAD_READY);
+
+  list_remove (&t->elem);
+  if (!edf_active (t) && list_empty (&c->ready_queues[idx]))
+    c->ready_bitmap[idx / 32] &= ~(1u << (idx % 32));
+  c->ready_cnt--;
+  if (t->pinned)
+    c->pinned_cnt--;
+}
+
+/* Returns the highest priority of any thread in C's run queue,
+   or PRI_MIN - 1 if the run queue is empty. */
+static int
+ready_queue_max_priority (struct cpu *c)
+{
+  int word;
+
+  for (word = DIV_ROUND_UP (PRI_CNT, 32) - 1; word >= 0; word--)
+    if (c->ready_bitmap[word] != 0)
+      return (PRI_MIN + word * 32 + 31
+              - __builtin_clz (c->ready_bitmap[word]));
+  return PRI_MIN - 1;
+}
+
+/* Removes and returns the real-time thread with the earliest
+   deadline on CPU C, if any, and otherwise the first thread in
+   the highest-priority nonempty run queue on CPU C, or a null
+   pointer if C's run queue is empty.  Interrupts must be off. */
+static struct thread *
+ready_queue_pop (struct cpu *c)
+{
+  struct thread *t = NULL;
+  int priority;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  priority = ready_queue_max_priority (c);
+  if (!list_empty (&c->edf_queue)) 
+    {
+      t = list_entry (list_pop_front (&c->edf_queue), struct thread, elem);
+      c->ready_cnt--;
+    }
+  else if (priority >= PRI_MIN) 
+    {
+      int idx = priority - PRI_MIN;
+
+      t = list_entry (list_pop_front (&c->ready_queues[idx]),
+                      struct thread, elem);
+      if (list_empty (&c->ready_queues[idx]))
+        c->ready_bitmap[idx / 32] &= ~(1u << (idx % 32));
+      c->ready_cnt--;
+    }
+  if (t != NULL && t->pinned)
+    c->pinned_cnt--;
+  return t;
+}
+
+/* Returns the CPU other than SELF with the most threads in its
+   run queue that may move to another CPU, or a null pointer if
+   no CPU has any. */
+static struct cpu *
+ready_queue_victim (struct cpu *self) 
+{
+  struct cpu *victim = NULL;
+  unsigned i;
+
+  for (i = 0; i < cpu_cnt; i++) 
+    {
+      struct cpu *c = &cpus[i];
+
+      if (c != self && c->ready_cnt > c->pinned_cnt
+          && (victim == NULL
+              || (c->ready_cnt - c->pinned_cnt
+                  > victim->ready_cnt - victim->pinned_cnt)))
+        victim = c;
+    }
+  return victim;
+}
+
+/* Returns the first thread in LIST, a run queue, that is not
+   pinned, or a null pointer if there is none. */
+static struct thread *
+first_unpinned (struct list *list) 
+{
+  struct list_elem *e;
+
+  for (e = list_begin (list); e != list_end (list); e = list_next (e))
+    {
+      struct thread *t = list_entry (e, struct thread, elem);
+      if (!t->pinned)
+        return t;
+    }
+  return NULL;
+}
+
+/* Removes and returns the highest-ranking thread that is not
+   pinned from the run queue of the CPU chosen by
+   ready_queue_victim(), for SELF to run, or returns a null
+   pointer if there is no such thread.  Interrupts must be off. */
+static struct thread *
+ready_queue_steal (struct cpu *self) 
+{
+  struct cpu *c = ready_queue_victim (self);
+  struct thread *t;
+  int priority;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (c == NULL)
+    return NULL;
+  t = first_unpinned (&c->edf_queue);
+  for (priority = ready_queue_max_priority (c);
+       t == NULL && priority >= PRI_MIN; priority--)
+    t = first_unpinned (&c->ready_queues[priority - PRI_MIN]);
+  ASSERT (t != NULL);
+
+  ready_queue_remove (t);
+  steals++;
+  return t;
+}
+
+/* Returns the CPU to whose run queue T, a thread that has just
+   become ready, should go: the boot CPU if T is pinned, and
+   otherwise this CPU if it is idle, then another idle CPU, then
+   this CPU if T should preempt its running thread, then the CPU
+   running the lowest-ranking thread that T outranks, and
+   otherwise this CPU.  Interrupts must be off. */
+static struct cpu *
+choose_cpu (const struct thread *t) 
+{
+  struct cpu *self = cpu_self ();
+  struct cpu *best = NULL;
+  unsigned i;
+
+  if (t->pinned)
+    return &cpus[0];
+  if (cpu_cnt == 1)
+    return self;
+
+  if (self->running == self->idle_thread && self->ready_cnt == 0)
+    return self;
+  for (i = 0; i < cpu_cnt; i++) 
+    {
+      struct cpu *c = &cpus[i];
+      if (c->running == c->idle_thread && c->ready_cnt == 0)
+        return c;
+    }
+
+  if (thread_outranks (t, self->running))
+    return self;
+  for (i = 0; i < cpu_cnt; i++) 
+    {
+      struct cpu *c = &cpus[i];
+      if (thread_outranks (t, c->running)
+          && (best == NULL || thread_outranks (best->running, c->running)))
+        best = c;
+    }
+  return best != NULL ? best : self;
+}
+
+/* Interrupts CPU C, if it is not this CPU, so that it
+   reschedules, if T, a thread just put in C's run queue, should
+   run there at once: if C is idle or T outranks the thread it is
+   running.  Interrupts must be off. */
+static void
+cpu_kick (struct cpu *c, const struct thread *t) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (c != cpu_self ()
+      && (c->running == c->idle_thread || thread_outranks (t, c->running)))
+    smp_kick (c - cpus);
+}
+
+/* Interrupts one idle CPU other than SELF, if there is one, so
+   that it steals a thread from a run queue.  Interrupts must be
+   off. */
+static void
+cpu_kick_idle (struct cpu *self) 
+{
+  unsigned i;
+
+  for (i = 0; i < cpu_cnt; i++) 
+    {
+      struct cpu *c = &cpus[i];
+
+      if (c != self && c->running == c->idle_thread && c->ready_cnt == 0)
+        {
+          smp_kick (i);
+          return;
+        }
+    }
+}
+
+/* Returns true if CPU C's run queue holds a thread that should
+   run in place of T, the running thread.  A real-time thread
+   with budget left outranks every other thread, and among such
+   threads an earlier deadline wins.  Otherwise the higher
+   priority wins.  If TIES is true, a thread that ranks the same
+   as T also counts, as at the end of T's time slice. */
+static bool
+ready_queue_preempts (struct cpu *c, const struct thread *t, bool ties) 
+{
+  if (!list_empty (&c->edf_queue)) 
+    {
+      struct thread *first = list_entry (list_front (&c->edf_queue),
+                                         struct thread, elem);
+      if (!edf_active (t))
+        return true;
+      return (ties
+              ? first->edf_abs_deadline <= t->edf_abs_deadline
+              : first->edf_abs_deadline < t->edf_abs_deadline);
+    }
+  if (edf_active (t))
+    return false;
+  return (ties
+          ? ready_queue_max_priority (c) >= t->priority
+          : ready_queue_max_priority (c) > t->priority);
+}
+
+/* Returns true if T is a real-time thread with budget left in
+   its current period, and thus scheduled by deadline. */
+static bool
+edf_active (const struct thread *t) 
+{
+  return t->edf_budget > 0;
+}
+
+/* Returns true if real-time thread A's deadline is earlier than
+   real-time thread B's. */
+static bool
+edf_deadline_less (const struct list_elem *a_, const struct list_elem *b_,
+                   void *aux UNUSED) 
+{
+  const struct thread *a = list_entry (a_, struct thread, elem);
+  const struct thread *b = list_entry (b_, struct thread, elem);
+
+  return a->edf_abs_deadline < b->edf_abs_deadline;
+}
+
+/* Returns the share of the CPU, in parts per thousand rounded
+   up, used by a thread that needs RUNTIME ticks within DEADLINE
+   ticks. */
+static int
+edf_thread_bandwidth (int runtime, int deadline) 
+{
+  return DIV_ROUND_UP (runtime * 1000, deadline);
+}
+
+/* Makes T, the running thread, an ordinary thread again and
+   gives back its reserved bandwidth.  Interrupts must be off. */
+static void
+edf_leave (struct thread *t) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (t->status != THREAD_READY);
+
+  list_remove (&t->edf_elem);
+  edf_bandwidth -= edf_thread_bandwidth (t->edf_runtime, t->edf_deadline);
+  t->edf_runtime = 0;
+  t->edf_budget = 0;
+}
+
+/* Called by thread_tick() on each CPU when there are real-time
+   threads.  Charges the tick that just ended to the running
+   thread CUR's budget, and makes CUR yield if that used the
+   budget up. */
+static void
+edf_tick (struct thread *cur) 
+{
+  if (edf_active (cur) && --cur->edf_budget == 0)
+    intr_yield_on_return ();
+}
+
+/* Called by thread_tick() on the boot CPU when there are
+   real-time threads.  Starts a new period for each real-time
+   thread whose current period has ended, refilling its budget
+   and moving its deadline, and counts a missed deadline if it
+   did not report its work done in time. */
+static void
+edf_new_periods (void) 
+{
+  int64_t now = timer_ticks ();
+  struct list_elem *e;
+
+  for (e = list_begin (&edf_list); e != list_end (&edf_list);
+       e = list_next (e))
+    {
+      struct thread *t = list_entry (e, struct thread, edf_elem);
+      bool queued = t->status == THREAD_READY;
+      struct cpu *c = t->cpu;
+
+      if (now < t->edf_release + t->edf_period)
+        continue;
+
+      if (queued)
+        ready_queue_remove (t);
+      t->edf_periods++;
+      if (!t->edf_met)
+        t->edf_misses++;
+      t->edf_met = false;
+
+      /* Periods that went by entirely while ticks were skipped
+         count only once. */
+      while (now >= t->edf_release + t->edf_period)
+        t->edf_release += t->edf_period;
+      t->edf_abs_deadline = t->edf_release + t->edf_deadline;
+      t->edf_budget = t->edf_runtime;
+      if (queued) 
+        {
+          ready_queue_push (c, t);
+          cpu_kick (c, t);
+        }
+    }
+}
+
+/* Returns true if T is the idle thread of some CPU. */
+static bool
+is_idle_thread (const struct thread *t) 
+{
+  unsigned i;
+
+  for (i = 0; i < CPU_MAX; i++)
+    if (cpus[i].idle_thread == t)
+      return true;
+  return false;
 }
-// prj1(priority) - sungmin oh - end //
-///////////////////////////////////////
 
+/* Returns the priority that the advanced scheduler assigns to T,
+   PRI_MAX - (recent_cpu / 4) - (nice * 2), clamped to the valid
+   range. */
+static int
+mlfqs_priority (const struct thread *t)
+{
+  int priority = fp_to_int (fp_sub (fp_from_int (PRI_MAX - t->nice * 2),
+                                    fp_div_int (t->recent_cpu, 4)));
+
+  if (priority < PRI_MIN)
+    return PRI_MIN;
+  if (priority > PRI_MAX)
+    return PRI_MAX;
+  return priority;
+}
+
+/* Applies one per-second decay with coefficient COEF to T's
+   recent_cpu. */
+static void
+mlfqs_decay (struct thread *t, fixed_point coef)
+{
+  t->recent_cpu = fp_add_int (fp_mul (coef, t->recent_cpu), t->nice);
+}
+
+/* Applies to T the decays that happened after second
+   T->decay_epoch, using the recorded coefficients. */
+static void
+mlfqs_catch_up (struct thread *t)
+{
+  ASSERT (decay_seconds - t->decay_epoch < DECAY_HISTORY);
+
+  while (t->decay_epoch < decay_seconds)
+    {
+      t->decay_epoch++;
+      mlfqs_decay (t, decay_coefs[t->decay_epoch % DECAY_HISTORY]);
+    }
+}
+
+/* Records that blocked thread T's recent_cpu is current as of
+   this second and puts it on the matching decay list.
+   Interrupts must be off. */
+static void
+mlfqs_park (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  t->decay_epoch = decay_seconds;
+  list_push_back (&decay_lists[decay_seconds % DECAY_HISTORY],
+                  &t->decay_elem);
+}
+
+/* Takes T off its decay list and applies the decays it missed
+   while blocked.  Interrupts must be off. */
+static void
+mlfqs_unpark (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  list_remove (&t->decay_elem);
+  mlfqs_catch_up (t);
+}
+
+/* Once-per-second update of load_avg and recent_cpu, followed by
+   recalculation of the priorities of all runnable threads.
+   Called from the boot CPU's timer interrupt. */
+static void
+mlfqs_update_second (void)
+{
+  struct thread *cur = running_thread ();
+  int ready_threads = 0;
+  int second = decay_seconds + 1;
+  struct list *stale = &decay_lists[second % DECAY_HISTORY];
+  struct list runnable;
+  struct list_elem *e;
+  fixed_point coef;
+  unsigned i;
+
+  ASSERT (intr_context ());
+
+  for (i = 0; i < cpu_cnt; i++)
+    ready_threads += (cpus[i].ready_cnt
+                      + !is_idle_thread (cpus[i].running));
+
+  /* load_avg = (59/60) * load_avg + (1/60) * ready_threads. */
+  load_avg = fp_div_int (fp_add_int (fp_mul_int (load_avg, 59),
+                                     ready_threads), 60);
+
+  /* coef = (2 * load_avg) / (2 * load_avg + 1). */
+  coef = fp_div (fp_mul_int (load_avg, 2),
+                 fp_add_int (fp_mul_int (load_avg, 2), 1));
+
+  /* Blocked threads last decayed DECAY_HISTORY seconds ago still
+     need the coefficient we are about to overwrite.  Bring them
+     up to date; they stay on the same list. */
+  for (e = list_begin (stale); e != list_end (stale); e = list_next (e))
+    {
+      struct thread *t = list_entry (e, struct thread, decay_elem);
+      mlfqs_catch_up (t);
+      mlfqs_decay (t, coef);
+      t->decay_epoch = second;
+    }
+  decay_coefs[second % DECAY_HISTORY] = coef;
+  decay_seconds = second;
+
+  /* Decay the running threads. */
+  for (i = 0; i < cpu_cnt; i++) 
+    {
+      struct thread *t = cpus[i].running;
+
+      if (!is_idle_thread (t))
+        {
+          mlfqs_decay (t, coef);
+          t->priority = mlfqs_priority (t);
+        }
+    }
+
+  /* Decay the ready threads and requeue them at their new
+     priorities, keeping their relative order. */
+  for (i = 0; i < cpu_cnt; i++) 
+    {
+      struct cpu *c = &cpus[i];
+      struct thread *t;
+
+      list_init (&runnable);
+      while ((t = ready_queue_pop (c)) != NULL)
+        list_push_back (&runnable, &t->elem);
+      while (!list_empty (&runnable))
+        {
+          t = list_entry (list_pop_front (&runnable), struct thread, elem);
+          mlfqs_decay (t, coef);
+          t->priority = mlfqs_priority (t);
+          ready_queue_push (c, t);
+        }
+      if (c != cpu_self () && ready_queue_preempts (c, c->running, false))
+        smp_kick (i);
+    }
+
+  if (ready_queue_preempts (cpu_self (), cur, false))
+    intr_yield_on_return ();
+}
 
 /* Chooses and returns the next thread to be scheduled.  Should
-   return a thread from the run queue, unless the run queue is
-   empty.  (If the running thread can continue running, then it
-   will be in the run queue.)  If the run queue is empty, return
-   idle_thread. */
+   return a thread from this CPU's run queue, unless the run
+   queue is empty.  (If the running thread can continue running,
+   then it will be in the run queue.)  If the run queue is empty,
+   steals a thread from another CPU's run queue, and if there is
+   none to steal, returns this CPU's idle thread. */
 static struct thread *
 next_thread_to_run (void) 
 {
-  if (list_empty (&ready_list)){
-    return idle_thread;
-  }else{
-    /////////////////////////////////////////
-    // prj1(priority) - sungmin oh - start //
-    // sort ready_list to put highest priority thread at the front
-    list_sort(&ready_list, higher_priority, NULL);
-    // prj1(priority) - sungmin oh - end //
-    ///////////////////////////////////////
-
-    return list_entry (list_pop_front (&ready_list), struct thread, elem);
-  }
+  struct cpu *self = cpu_self ();
+  struct thread *next = ready_queue_pop (self);
+
+  if (next == NULL && cpu_cnt > 1)
+    next = ready_queue_steal (self);
+  return next != NULL ? next : self->idle_thread;
 }
 
 
@@ -660,9 +1942,16 @@ thread_schedule_tail (struct thread *prev)
 
   /* Mark us as running. */
   cur->status = THREAD_RUNNING;
+  if (prev != NULL)
+    cur->scheduled++;
+  if (cur->ready_since != 0) 
+    {
+      record_wait (cur, timer_now_ns () - cur->ready_since);
+      cur->ready_since = 0;
+    }
 
   /* Start new time slice. */
-  thread_ticks = 0;
+  cpu_self ()->thread_ticks = 0;
 
 #ifdef USERPROG
   /* Activate the new address space. */
@@ -677,7 +1966,7 @@ thread_schedule_tail (struct thread *prev)
   if (prev != NULL && prev->status == THREAD_DYING && prev != initial_thread) 
     {
       ASSERT (prev != cur);
-      palloc_free_page (prev);
+      thread_page_put (prev);
     }
 }
 
@@ -691,6 +1980,7 @@ thread_schedule_tail (struct thread *prev)
 static void
 schedule (void) 
 {
+  struct cpu *self = cpu_self ();
   struct thread *cur = running_thread ();
   struct thread *next = next_thread_to_run ();
   struct thread *prev = NULL;
@@ -699,21 +1989,52 @@ schedule (void)
   ASSERT (cur->status != THREAD_RUNNING);
   ASSERT (is_thread (next));
 
+  next->running_on = self;
+  self->running = next;
+
+  /* If threads are left waiting here that another CPU could
+     run, wake up an idle CPU to steal one. */
+  if (cpu_cnt > 1 && self->ready_cnt > self->pinned_cnt)
+    cpu_kick_idle (self);
+
   if (cur != next)
-    prev = switch_threads (cur, next);
+    {
+      /* An interrupt that readied a thread may switch away from
+         the idle thread before it gets back to timer_idle_exit(),
+         so restart a stopped tick here. */
+      if (cur == self->idle_thread)
+        timer_idle_exit ();
+
+      /* A thread that is still runnable was preempted; one that
+         blocked gave up the CPU on its own. */
+      if (cur->status == THREAD_READY)
+        {
+          cur->involuntary_switches++;
+          involuntary_switches++;
+        }
+      else if (cur->status == THREAD_BLOCKED)
+        {
+          cur->voluntary_switches++;
+          voluntary_switches++;
+        }
+      prev = switch_threads (cur, next);
+    }
   thread_schedule_tail (prev);
 }
 
-/* Returns a tid to use for a new thread. */
+/* Returns a tid to use for a new thread.  Incrementing a
+   counter is too little work to justify a lock; disabling
+   interrupts is enough. */
 static tid_t
 allocate_tid (void) 
 {
   static tid_t next_tid = 1;
+  enum intr_level old_level;
   tid_t tid;
 
-  lock_acquire (&tid_lock);
+  old_level = intr_disable ();
   tid = next_tid++;
-  lock_release (&tid_lock);
+  intr_set_level (old_level);
 
   return tid;
 }
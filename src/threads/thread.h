@@ -3,7 +3,9 @@
 
 #include <debug.h>
 #include <list.h>
+#include <sched-stats.h>
 #include <stdint.h>
+#include "threads/fixed-point.h"
 #include "threads/synch.h"
 
 /* States in a thread's life cycle. */
@@ -25,6 +27,14 @@ typedef int tid_t;
 #define PRI_DEFAULT 31                  /* Default priority. */
 #define PRI_MAX 63                      /* Highest priority. */
 
+/* Thread niceness, used by the advanced scheduler. */
+#define NICE_MIN -20                    /* Nicest to other threads. */
+#define NICE_DEFAULT 0                  /* Default niceness. */
+#define NICE_MAX 20                     /* Least nice. */
+
+/* Default time slice, in timer ticks. */
+#define TIME_SLICE 4
+
 struct child_process{
 	tid_t tid;
 	bool load;
@@ -33,6 +43,9 @@ struct child_process{
     int exit;
 	struct list_elem elem;
 };
+
+/* Cache that child_process records are allocated from. */
+extern struct kmem_cache *child_process_cache;
 /* A kernel thread or user process.
 
    Each thread structure is stored in its own 4 kB page.  The
@@ -83,12 +96,11 @@ struct child_process{
    the `magic' member of the running thread's `struct thread' is
    set to THREAD_MAGIC.  Stack overflow will normally change this
    value, triggering the assertion. */
-/* The `elem' member has a dual purpose.  It can be an element in
-   the run queue (thread.c), or it can be an element in a
-   semaphore wait list (synch.c).  It can be used these two ways
-   only because they are mutually exclusive: only a thread in the
-   ready state is on the run queue, whereas only a thread in the
-   blocked state is on a semaphore wait list. */
+/* The `elem' member is an element in the run queue (thread.c).
+   A blocked thread waiting on a semaphore or condition variable
+   is instead in that object's priority wait queue, through
+   `wait_elem' (synch.c), so that it can be moved within the queue
+   if its priority changes while it waits. */
 struct thread
   {
     /* Owned by thread.c. */
@@ -109,38 +121,83 @@ struct thread
 
     /* Shared between thread.c and synch.c. */
     struct list_elem elem;              /* List element. */
+    struct cpu *cpu;                    /* CPU whose run queue has it. */
+    struct cpu *running_on;             /* CPU running it, if running. */
+    bool pinned;                        /* Runs on the boot CPU only? */
 
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
     uint32_t *pagedir;                  /* Page directory. */
     char pname[32]; // khg : argv[0]
 
+    /* Owned by userprog/process.c.  A process may run several
+       threads, which share the main thread's page directory and
+       file table.  The fields after `uthread' are used only in
+       the main thread. */
+    struct thread *leader;              /* Process's main thread. */
+    struct user_thread *uthread;        /* Join record, if not main. */
+    struct lock uthread_lock;           /* Protects the following. */
+    struct list uthreads;               /* Join records of others. */
+    int uthread_cnt;                    /* # of others still running. */
+    struct condition uthreads_done;     /* Signaled when that hits 0. */
+    uint32_t stack_slots;               /* Bitmap of user stacks in use. */
+    bool exiting;                       /* Process exiting? */
+    int exit_status;                    /* Process's status, if exiting. */
 #endif
 
     /* Owned by thread.c. */
     unsigned magic;                     /* Detects stack overflow. */
     
-    /////////////////////////////////////
-    // prj1(wait) - sungmin oh - start //
-    // when the thread is getting in sleep,
-    // to remember when it would wake up.
-    int64_t wakeup_ticks;
-    // prj1(wait) - sungmin oh - end //
-    ///////////////////////////////////
-    
-    /////////////////////////////////////////
-    // prj1(donation) - sungmin oh - start //
-    // lock which this thread want to optain 
-    struct lock* locked;
-    // locks which this thread already have
-    struct list lock_list;
-    // original priority in case thread get donated by higher priority thraed
-    int original_priority;
-    // to know this thread get donated or not
-    bool donated;
-    // prj1(donation) - sungmin oh - end //
-    ///////////////////////////////////////
-  
+    /* Owned by synch.c. */
+    struct pqueue *wait_queue;          /* Queue waited in, or null. */
+    struct pqueue_elem wait_elem;       /* Element in wait_queue. */
+
+    /* Owned by synch.c, used only if !thread_mlfqs. */
+    int base_priority;                  /* Priority without donations. */
+    struct lock *waiting_lock;          /* Lock being waited for. */
+    struct heap held_locks;             /* Locks held, by max_priority. */
+
+    /* Owned by thread.c, used only if thread_mlfqs. */
+    int nice;                           /* Niceness. */
+    fixed_point recent_cpu;             /* Recent CPU usage. */
+    int decay_epoch;                    /* Second recent_cpu was last decayed. */
+    struct list_elem decay_elem;        /* Pending-decay list element. */
+
+    /* Owned by thread.c. */
+    unsigned time_slice;                /* Ticks per slice, 0=default. */
+    unsigned voluntary_switches;        /* # of times it blocked. */
+    unsigned involuntary_switches;      /* # of times it was preempted. */
+    unsigned user_ticks;                /* Ticks running user code. */
+    unsigned kernel_ticks;              /* Ticks running in the kernel. */
+    unsigned scheduled;                 /* # of times switched to. */
+    int64_t ready_since;                /* timer_now_ns() when made ready,
+                                           0 if not waiting to run. */
+    unsigned wait_hist[SCHED_WAIT_BUCKETS]; /* Run-queue waits, by
+                                           log2 of microseconds. */
+
+    /* Owned by thread.c, used only by real-time threads.  See
+       thread_set_realtime().  Times are in timer ticks. */
+    int edf_runtime;                    /* Budget per period, 0=not EDF. */
+    int edf_deadline;                   /* Deadline, relative to release. */
+    int edf_period;                     /* Period. */
+    int edf_budget;                     /* Budget left in this period. */
+    int64_t edf_release;                /* Start of the current period. */
+    int64_t edf_abs_deadline;           /* Deadline of the current period. */
+    bool edf_met;                       /* Work for this period done
+                                           by its deadline? */
+    unsigned edf_periods;               /* # of periods ended. */
+    unsigned edf_misses;                /* # of those whose deadline
+                                           was missed. */
+    struct list_elem edf_elem;          /* Element in edf_list. */
+  };
+
+/* A set of threads woken up together, so that the waker decides
+   only once whether to give up the CPU to one of them.  See
+   wake_batch_init(). */
+struct wake_batch
+  {
+    struct thread *best;                /* Highest-ranking thread woken. */
+    unsigned cnt;                       /* # of threads woken. */
   };
 
 /* If false (default), use round-robin scheduler.
@@ -148,11 +205,21 @@ struct thread
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/* Default time slice in timer ticks.
+   Controlled by kernel command-line option "-ts=TICKS". */
+extern unsigned thread_time_slice;
+
 void thread_init (void);
 void thread_start (void);
+struct thread *thread_prepare_ap (unsigned cpu);
+void thread_start_ap (volatile bool *started) NO_RETURN;
+unsigned thread_cpu_id (void);
+unsigned thread_cpu_cnt (void);
+void thread_pin (void);
 
 void thread_tick (void);
 void thread_print_stats (void);
+void thread_get_stats (const struct thread *, struct sched_stats *);
 
 typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
@@ -160,6 +227,11 @@ tid_t thread_create (const char *name, int priority, thread_func *, void *);
 void thread_block (void);
 void thread_unblock (struct thread *);
 
+void wake_batch_init (struct wake_batch *);
+void wake_batch_add (struct wake_batch *, struct thread *);
+void wake_batch_finish (struct wake_batch *, bool yield);
+void thread_check_preempt (void);
+
 struct thread *thread_current (void);
 tid_t thread_tid (void);
 const char *thread_name (void);
@@ -173,26 +245,24 @@ void thread_foreach (thread_action_func *, void *);
 
 int thread_get_priority (void);
 void thread_set_priority (int);
+void thread_set_effective_priority (struct thread *, int);
+void thread_update_priority (struct thread *);
+
+void thread_set_time_slice (unsigned);
+unsigned thread_get_time_slice (void);
+
+bool thread_set_realtime (int runtime, int deadline, int period);
+bool thread_wait_period (void);
+bool thread_preempts (const struct thread *);
 
 int thread_get_nice (void);
 void thread_set_nice (int);
 int thread_get_recent_cpu (void);
 int thread_get_load_avg (void);
 
-/////////////////////////////////////
-// prj1(wait) - sungmin oh - start //
-// thread.c is not imported by any other.
-// only thread.h is importe.
-// so, what we want to use must be declared in thread.h
-// it is implemented in /threads/thread.c
-struct list* wait_list_ptr(void);
-// prj1(wait) - sungmin oh - end //
-///////////////////////////////////
-
 ////////////////////////////////////////
 // prj1(priority) - sungmin oh - start //
 // it is implemented in /thread/thread.c
-bool higher_priority(struct list_elem*, struct list_elem*, void*); 
 //void priority_check(void);
 // prj1(priority) - sungmin oh end //
 ////////////////////////////////////
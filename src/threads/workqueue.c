@@ -0,0 +1,231 @@
+#include "threads/workqueue.h"
+#include <debug.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/spinlock.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Number of worker threads.  With more than one, other work
+   can go ahead while an item sleeps. */
+#define WORKER_CNT 2
+
+/* Queued work items, one queue per priority, each in FIFO
+   order.  Protected by queue_lock, since items are queued from
+   interrupt handlers. */
+static struct list queues[WORK_PRI_CNT];
+static struct spinlock queue_lock;
+
+/* Upped once for each item queued.  Cancelling an item does not
+   down it, so a worker may wake up to find nothing to do. */
+static struct semaphore work_avail;
+
+/* Statistics. */
+static long long queued_cnt;    /* # of items queued. */
+static long long run_cnt;       /* # of items run. */
+static long long cancel_cnt;    /* # of pending items cancelled. */
+
+static thread_func worker;
+static void work_timer_fire (void *w);
+
+/* Initializes the work queues.  Must be called before interrupts
+   are enabled, because interrupt handlers may queue work as soon
+   as they are. */
+void
+workqueue_init (void) 
+{
+  int pri;
+
+  for (pri = 0; pri < WORK_PRI_CNT; pri++)
+    list_init (&queues[pri]);
+  spinlock_init (&queue_lock);
+  sema_init (&work_avail, 0);
+}
+
+/* Starts the worker threads.  Must be called after
+   thread_start().  Work queued earlier runs now. */
+void
+workqueue_start (void) 
+{
+  int i;
+
+  for (i = 0; i < WORKER_CNT; i++) 
+    {
+      char name[16];
+
+      snprintf (name, sizeof name, "worker%d", i);
+      if (thread_create (name, PRI_MAX, worker, NULL) == TID_ERROR)
+        PANIC ("cannot create worker thread");
+    }
+}
+
+/* Initializes W, which is not queued, to call FUNC(AUX) from a
+   worker thread at priority PRIORITY when it is run. */
+void
+work_init (struct work *w, work_func *func, void *aux,
+           enum work_priority priority) 
+{
+  ASSERT (w != NULL);
+  ASSERT (func != NULL);
+  ASSERT (priority >= 0 && priority < WORK_PRI_CNT);
+
+  w->func = func;
+  w->aux = aux;
+  w->priority = priority;
+  w->queued = false;
+  timer_event_init (&w->timer, work_timer_fire, w);
+}
+
+/* Queues W to be run by a worker thread.  Returns true if W was
+   queued, false if it was already queued and so is left as it
+   is.  W may be queued again as soon as a worker has taken it
+   off the queue, even while its function is still running.
+
+   This function may be called from an interrupt handler, in
+   which case the worker runs as soon as the handler returns. */
+bool
+work_queue (struct work *w) 
+{
+  bool queued;
+
+  ASSERT (w != NULL);
+
+  spinlock_acquire (&queue_lock);
+  queued = !w->queued;
+  if (queued) 
+    {
+      list_push_back (&queues[w->priority], &w->elem);
+      w->queued = true;
+      queued_cnt++;
+    }
+  spinlock_release (&queue_lock);
+
+  if (queued) 
+    {
+      sema_up (&work_avail);
+      if (intr_context () && thread_get_priority () < PRI_MAX)
+        intr_yield_on_return ();
+    }
+  return queued;
+}
+
+/* Queues W after TICKS timer ticks have passed, or at once if
+   TICKS is not positive.  Returns true if successful, false if W
+   was already queued or waiting for its delay to pass.
+
+   This function may be called from an interrupt handler. */
+bool
+work_queue_delayed (struct work *w, int64_t ticks) 
+{
+  enum intr_level old_level;
+  bool success = false;
+
+  ASSERT (w != NULL);
+
+  if (ticks <= 0)
+    return work_queue (w);
+
+  old_level = intr_disable ();
+  if (!work_pending (w)) 
+    {
+      timer_event_arm (&w->timer, timer_ticks () + ticks);
+      success = true;
+    }
+  intr_set_level (old_level);
+
+  return success;
+}
+
+/* Timer event function for work_queue_delayed(). */
+static void
+work_timer_fire (void *w) 
+{
+  work_queue (w);
+}
+
+/* Takes W off its queue, or disarms its delay, so that it will
+   not run.  Returns true if W was pending, false otherwise.  If
+   W's function is already running it is not waited for.
+
+   This function may be called from an interrupt handler. */
+bool
+work_cancel (struct work *w) 
+{
+  enum intr_level old_level;
+  bool cancelled;
+
+  ASSERT (w != NULL);
+
+  old_level = intr_disable ();
+  cancelled = timer_event_cancel (&w->timer);
+  spinlock_acquire (&queue_lock);
+  if (w->queued) 
+    {
+      list_remove (&w->elem);
+      w->queued = false;
+      cancelled = true;
+    }
+  if (cancelled)
+    cancel_cnt++;
+  spinlock_release (&queue_lock);
+  intr_set_level (old_level);
+
+  return cancelled;
+}
+
+/* Returns true if W is queued or waiting for its delay to
+   pass. */
+bool
+work_pending (const struct work *w) 
+{
+  ASSERT (w != NULL);
+
+  return w->queued || w->timer.armed;
+}
+
+/* Prints workqueue statistics. */
+void
+workqueue_print_stats (void) 
+{
+  printf ("Workqueue: %lld queued, %lld run, %lld cancelled\n",
+          queued_cnt, run_cnt, cancel_cnt);
+}
+
+/* Worker thread.  Repeatedly runs the oldest item of the highest
+   priority that has any, sleeping while there are none. */
+static void
+worker (void *aux UNUSED) 
+{
+  /* Under the MLFQS, stay near the top of the priority range
+     despite time spent running work. */
+  if (thread_mlfqs)
+    thread_set_nice (NICE_MIN);
+
+  for (;;) 
+    {
+      work_func *func = NULL;
+      void *aux = NULL;
+      int pri;
+
+      sema_down (&work_avail);
+
+      spinlock_acquire (&queue_lock);
+      for (pri = 0; pri < WORK_PRI_CNT; pri++)
+        if (!list_empty (&queues[pri])) 
+          {
+            struct work *w = list_entry (list_pop_front (&queues[pri]),
+                                         struct work, elem);
+            w->queued = false;
+            func = w->func;
+            aux = w->aux;
+            run_cnt++;
+            break;
+          }
+      spinlock_release (&queue_lock);
+
+      /* W may be freed or requeued by the time FUNC returns, so
+         do not touch it past this point. */
+      if (func != NULL)
+        func (aux);
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "devices/timer.h"
+
+/* Kernel workqueue.
+
+   A work item is a function call deferred to a pool of kernel
+   worker threads.  Interrupt handlers use it to push anything
+   that takes more than a few instructions out of interrupt
+   context: the handler queues the item and returns, and a worker
+   runs it soon after with interrupts on, where it may take locks
+   and even sleep.  Workers run at PRI_MAX, so queued work runs
+   before any other thread.
+
+   Each item has one of WORK_PRI_CNT priorities, and a worker
+   always takes the oldest item of the highest priority that has
+   any.  An item is in at most one queue at a time: queuing an
+   item that is already pending does nothing. */
+enum work_priority
+  {
+    WORK_PRI_HIGH,              /* Latency-sensitive, e.g. wakeups. */
+    WORK_PRI_NORMAL,            /* Ordinary deferred work. */
+    WORK_PRI_LOW,               /* Background, e.g. flush daemons. */
+    WORK_PRI_CNT                /* Number of priorities. */
+  };
+
+typedef void work_func (void *aux);
+struct work
+  {
+    struct list_elem elem;              /* Element in a work queue. */
+    work_func *func;                    /* Function to call. */
+    void *aux;                          /* Auxiliary data for FUNC. */
+    enum work_priority priority;        /* Queue to run from. */
+    bool queued;                        /* In a work queue? */
+    struct timer_event timer;           /* For work_queue_delayed(). */
+  };
+
+void workqueue_init (void);
+void workqueue_start (void);
+
+void work_init (struct work *, work_func *, void *aux, enum work_priority);
+bool work_queue (struct work *);
+bool work_queue_delayed (struct work *, int64_t ticks);
+bool work_cancel (struct work *);
+bool work_pending (const struct work *);
+
+void workqueue_print_stats (void);
+
+#endif /* threads/workqueue.h */
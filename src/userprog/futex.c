@@ -0,0 +1,200 @@
+#include "userprog/futex.h"
+#include <debug.h>
+#include <hash.h>
+#include "threads/slab.h"
+#include "threads/synch.h"
+#include "userprog/process.h"
+
+/* A futex that has sleepers, identified by the process that owns
+   it, through the process's main thread, and its user address. */
+struct futex
+  {
+    struct hash_elem elem;      /* Element in `futexes'. */
+    struct thread *leader;      /* Main thread of owning process. */
+    const int *addr;            /* User address. */
+    struct condition sleepers;  /* Sleeping threads, by priority. */
+    int sleeper_cnt;            /* # of threads in SLEEPERS. */
+  };
+
+/* Futexes that have sleepers.  A futex is added by the first
+   thread to sleep on it and removed by the wakeup that leaves it
+   with none. */
+static struct hash futexes;
+static struct lock futex_lock;
+
+/* Cache that futexes are allocated from.  A futex is freed only
+   once it has no sleepers, so its condition variable stays
+   initialized from one use to the next. */
+static struct kmem_cache *futex_cache;
+
+static hash_hash_func futex_hash;
+static hash_less_func futex_less;
+static struct futex *futex_lookup (struct thread *leader, const int *addr);
+static int wake_sleepers (struct futex *, int cnt);
+static kmem_ctor_func futex_ctor;
+
+/* Initializes the futex table. */
+void
+futex_init (void) 
+{
+  hash_init (&futexes, futex_hash, futex_less, NULL);
+  lock_init (&futex_lock);
+  futex_cache = kmem_cache_create ("futex", sizeof (struct futex),
+                                   futex_ctor);
+}
+
+/* Constructor for futexes: a futex with no sleepers. */
+static void
+futex_ctor (void *f_) 
+{
+  struct futex *f = f_;
+
+  cond_init (&f->sleepers);
+  f->sleeper_cnt = 0;
+}
+
+/* If the int at ADDR, a valid, aligned user address in the
+   current process, equals VAL, sleeps until woken by
+   futex_wake() and returns 0.  Otherwise returns -1 at once.
+   Checking the value and going to sleep are atomic with respect
+   to futex_wake(), so a wakeup that follows a change to the
+   value is never lost. */
+int
+futex_wait (const int *addr, int val) 
+{
+  struct thread *leader = thread_current ()->leader;
+  struct futex *f;
+
+  lock_acquire (&futex_lock);
+  if (*addr != val || process_exiting ()) 
+    {
+      lock_release (&futex_lock);
+      return -1;
+    }
+
+  f = futex_lookup (leader, addr);
+  if (f == NULL) 
+    {
+      f = kmem_cache_alloc (futex_cache);
+      if (f == NULL) 
+        {
+          lock_release (&futex_lock);
+          return -1;
+        }
+      f->leader = leader;
+      f->addr = addr;
+      hash_insert (&futexes, &f->elem);
+    }
+  f->sleeper_cnt++;
+  cond_wait (&f->sleepers, &futex_lock);
+  lock_release (&futex_lock);
+  return 0;
+}
+
+/* Wakes up to CNT threads of the current process sleeping on the
+   futex at ADDR, highest priority first, and returns the number
+   woken. */
+int
+futex_wake (const int *addr, int cnt) 
+{
+  struct futex *f;
+  int woken = 0;
+
+  lock_acquire (&futex_lock);
+  f = futex_lookup (thread_current ()->leader, addr);
+  if (f != NULL)
+    woken = wake_sleepers (f, cnt);
+  lock_release (&futex_lock);
+  return woken;
+}
+
+/* Wakes every thread sleeping on a futex of the process whose
+   main thread is LEADER, which is exiting.  Called after
+   LEADER's process_exiting() flag has been set, so that none of
+   them goes back to sleep. */
+void
+futex_exit (struct thread *leader) 
+{
+  struct hash_iterator i;
+  bool found;
+
+  lock_acquire (&futex_lock);
+  do
+    {
+      found = false;
+      hash_first (&i, &futexes);
+      while (hash_next (&i)) 
+        {
+          struct futex *f = hash_entry (hash_cur (&i), struct futex, elem);
+          if (f->leader == leader) 
+            {
+              /* Waking the last sleeper deletes F, which
+                 invalidates I, so start over. */
+              wake_sleepers (f, f->sleeper_cnt);
+              found = true;
+              break;
+            }
+        }
+    }
+  while (found);
+  lock_release (&futex_lock);
+}
+
+/* Wakes up to CNT of F's sleepers and returns the number woken.
+   If that leaves F with no sleepers, deletes it.  futex_lock
+   must be held. */
+static int
+wake_sleepers (struct futex *f, int cnt) 
+{
+  int woken = 0;
+
+  ASSERT (lock_held_by_current_thread (&futex_lock));
+
+  while (woken < cnt && f->sleeper_cnt > 0) 
+    {
+      f->sleeper_cnt--;
+      cond_signal (&f->sleepers, &futex_lock);
+      woken++;
+    }
+  if (f->sleeper_cnt == 0) 
+    {
+      hash_delete (&futexes, &f->elem);
+      kmem_cache_free (futex_cache, f);
+    }
+  return woken;
+}
+
+/* Returns the futex of the process whose main thread is LEADER
+   at ADDR, or a null pointer if it has no sleepers. */
+static struct futex *
+futex_lookup (struct thread *leader, const int *addr) 
+{
+  struct futex key;
+  struct hash_elem *e;
+
+  key.leader = leader;
+  key.addr = addr;
+  e = hash_find (&futexes, &key.elem);
+  return e != NULL ? hash_entry (e, struct futex, elem) : NULL;
+}
+
+/* Returns a hash value for futex E. */
+static unsigned
+futex_hash (const struct hash_elem *e, void *aux UNUSED) 
+{
+  const struct futex *f = hash_entry (e, struct futex, elem);
+  return hash_int ((int) f->addr ^ (int) f->leader);
+}
+
+/* Returns true if futex A precedes futex B. */
+static bool
+futex_less (const struct hash_elem *a_, const struct hash_elem *b_,
+            void *aux UNUSED) 
+{
+  const struct futex *a = hash_entry (a_, struct futex, elem);
+  const struct futex *b = hash_entry (b_, struct futex, elem);
+
+  if (a->leader != b->leader)
+    return a->leader < b->leader;
+  return a->addr < b->addr;
+}
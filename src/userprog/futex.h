@@ -0,0 +1,18 @@
+#ifndef USERPROG_FUTEX_H
+#define USERPROG_FUTEX_H
+
+#include "threads/thread.h"
+
+/* Futexes ("fast user-space mutexes").
+
+   A futex is any aligned int in a process's memory.  User code
+   synchronizes through atomic operations on the int and calls
+   into the kernel only to sleep while it has a given value or to
+   wake sleepers, so uncontended locking never traps.  The kernel
+   keeps a wait queue only for futexes that have sleepers. */
+void futex_init (void);
+int futex_wait (const int *addr, int val);
+int futex_wake (const int *addr, int cnt);
+void futex_exit (struct thread *leader);
+
+#endif /* userprog/futex.h */
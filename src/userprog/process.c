@@ -14,14 +14,22 @@
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "devices/timer.h" // khg
 #include "userprog/syscall.h"
+#include "userprog/futex.h"
 
 static thread_func start_process NO_RETURN;
+static thread_func start_user_thread NO_RETURN;
 static bool load (const char *cmdline, void (**eip) (void), void **esp);
+static bool install_page (void *upage, void *kpage, bool writable);
+static void uthreads_stop (struct thread *leader);
+static void uthread_exit (struct thread *);
 //khg 
 /* Starts a new thread running a user program loaded from
    FILENAME.  The new thread may be scheduled (and may even exit)
@@ -65,6 +73,9 @@ start_process (void *file_name_)
   int argc = 0;
   char *argv_p[32] = {}; 
 
+  /* User code runs only on the boot CPU. */
+  thread_pin ();
+
   /* Initialize interrupt frame and load executable. */
   memset (&if_, 0, sizeof if_);
   if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
@@ -176,7 +187,7 @@ process_wait (tid_t child_tid UNUSED)
 	int status = cp->exit;
 
  	list_remove(&cp->elem);
-	free(cp);
+	kmem_cache_free (child_process_cache, cp);
 
   return status;
 
@@ -209,7 +220,13 @@ process_exit (void)
   struct thread *cur = thread_current ();
   uint32_t *pd;
 
-  my_close(CLOSE_ALL);
+  /* The main thread must outlive the process's other threads,
+     which share its page directory and files. */
+  if (cur->leader == cur)
+    {
+      uthreads_stop (cur);
+      my_close(CLOSE_ALL);
+    }
   
 	//printf("remove all child_list\n");
 	struct list_elem * e = list_begin(&cur->child_list);
@@ -221,10 +238,16 @@ process_exit (void)
 		//printf("tid is %d\n", cp->tid);
 		e = list_next(e);
 		list_remove(&cp->elem);
-		free(cp);
+		kmem_cache_free (child_process_cache, cp);
 	}
 	//
 	//printf("remove finish\n");
+  if (cur->leader != cur)
+    {
+      uthread_exit (cur);
+      return;
+    }
+
 	/* Destroy the current process's page directory and switch back
      to the kernel-only page directory. */
   pd = cur->pagedir;
@@ -255,8 +278,309 @@ process_activate (void)
   pagedir_activate (t->pagedir);
 
   /* Set thread's kernel stack for use in processing
-     interrupts. */
-  tss_update ();
+     interrupts.  Only the boot CPU runs user code, so only it
+     has a TSS. */
+  if (thread_cpu_id () == 0)
+    tss_update ();
+}
+
+/* User threads.
+
+   A process's main thread may create further threads that run
+   in the same address space.  Each is a kernel thread of its own
+   with its own one-page user stack, in one of UTHREAD_SLOTS
+   slots spaced two pages apart below the main thread's stack, so
+   that an overflow faults instead of running into a neighbor.
+   All of them share the main thread's page directory and file
+   table.
+
+   If any thread calls exit() or is killed, the whole process
+   exits: see process_kill().  When the main thread exits, it
+   waits for the other threads to exit first.  Each of them does
+   so the next time it would return to user mode, so the wait is
+   short unless one is blocked in the kernel.  Threads asleep on
+   a futex are woken up for the purpose. */
+#define UTHREAD_SLOTS 32
+
+/* Join record for a user thread other than a process's main
+   thread.  Owned by the main thread and kept on its `uthreads'
+   list, under its `uthread_lock', until joined or until the main
+   thread exits. */
+struct user_thread
+  {
+    tid_t tid;                  /* Thread's tid. */
+    int slot;                   /* Stack slot, 1...UTHREAD_SLOTS-1. */
+    int status;                 /* Exit status. */
+    bool joined;                /* Someone joining it? */
+    struct semaphore dead;      /* Upped when the thread exits. */
+    struct list_elem elem;      /* Element in main thread's uthreads. */
+  };
+
+/* Information passed from process_thread_create() to
+   start_user_thread(). */
+struct uthread_start
+  {
+    struct thread *leader;      /* Process's main thread. */
+    struct user_thread *uthread; /* New thread's join record. */
+    void (*entry) (void);       /* User code to start at. */
+    void *func, *aux;           /* Arguments to ENTRY. */
+    struct semaphore started;   /* Upped once the above are read. */
+  };
+
+/* Returns the user address of the page of stack slot SLOT. */
+static uint8_t *
+stack_slot_page (int slot)
+{
+  return (uint8_t *) PHYS_BASE - PGSIZE - slot * 2 * PGSIZE;
+}
+
+/* Starts a new thread in the current process, running user code
+   at ENTRY as if called as ENTRY(FUNC, AUX).  Returns the new
+   thread's tid, or TID_ERROR if it cannot be created. */
+tid_t
+process_thread_create (void (*entry) (void), void *func, void *aux)
+{
+  struct thread *cur = thread_current ();
+  struct thread *leader = cur->leader;
+  struct uthread_start start;
+  struct user_thread *ut;
+  struct child_process *cp;
+  uint8_t *kpage = NULL;
+  int slot = -1;
+  tid_t tid;
+
+  ut = malloc (sizeof *ut);
+  if (ut == NULL)
+    return TID_ERROR;
+
+  /* Claim a stack slot and map a stack page in it. */
+  lock_acquire (&leader->uthread_lock);
+  if (!leader->exiting)
+    for (slot = 1; slot < UTHREAD_SLOTS; slot++)
+      if (!(leader->stack_slots & (1u << slot)))
+        break;
+  if (slot > 0 && slot < UTHREAD_SLOTS)
+    kpage = palloc_get_page (PAL_USER | PAL_ZERO);
+  if (kpage == NULL || !install_page (stack_slot_page (slot), kpage, true))
+    {
+      lock_release (&leader->uthread_lock);
+      if (kpage != NULL)
+        palloc_free_page (kpage);
+      free (ut);
+      return TID_ERROR;
+    }
+  leader->stack_slots |= 1u << slot;
+  ut->slot = slot;
+  ut->status = -1;
+  ut->joined = false;
+  sema_init (&ut->dead, 0);
+  list_push_back (&leader->uthreads, &ut->elem);
+  leader->uthread_cnt++;
+  lock_release (&leader->uthread_lock);
+
+  start.leader = leader;
+  start.uthread = ut;
+  start.entry = entry;
+  start.func = func;
+  start.aux = aux;
+  sema_init (&start.started, 0);
+  tid = thread_create (leader->name, PRI_DEFAULT, start_user_thread, &start);
+  if (tid == TID_ERROR)
+    {
+      /* Exit on the thread's behalf. */
+      lock_acquire (&leader->uthread_lock);
+      pagedir_clear_page (cur->pagedir, stack_slot_page (slot));
+      palloc_free_page (kpage);
+      leader->stack_slots &= ~(1u << slot);
+      list_remove (&ut->elem);
+      free (ut);
+      if (--leader->uthread_cnt == 0)
+        cond_broadcast (&leader->uthreads_done, &leader->uthread_lock);
+      lock_release (&leader->uthread_lock);
+      return TID_ERROR;
+    }
+  sema_down (&start.started);
+
+  /* thread_create() recorded the thread as our child process,
+     but it is joined with process_thread_join() instead. */
+  cp = get_child_by_tid (tid);
+  if (cp != NULL)
+    {
+      list_remove (&cp->elem);
+      kmem_cache_free (child_process_cache, cp);
+    }
+  return tid;
+}
+
+/* A thread function that starts a user thread created by
+   process_thread_create(). */
+static void
+start_user_thread (void *start_)
+{
+  struct uthread_start *start = start_;
+  struct thread *t = thread_current ();
+  struct intr_frame if_;
+  uint32_t *esp;
+
+  /* User code runs only on the boot CPU. */
+  thread_pin ();
+
+  t->leader = start->leader;
+  t->uthread = start->uthread;
+  t->uthread->tid = t->tid;
+  t->cp = NULL;
+  t->pagedir = t->leader->pagedir;
+  strlcpy (t->pname, t->leader->pname, sizeof t->pname);
+  process_activate ();
+
+  /* Call ENTRY(FUNC, AUX) with a null return address. */
+  esp = (uint32_t *) (stack_slot_page (t->uthread->slot) + PGSIZE);
+  *--esp = (uint32_t) start->aux;
+  *--esp = (uint32_t) start->func;
+  *--esp = 0;
+
+  memset (&if_, 0, sizeof if_);
+  if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
+  if_.cs = SEL_UCSEG;
+  if_.eflags = FLAG_IF | FLAG_MBS;
+  if_.eip = start->entry;
+  if_.esp = esp;
+  sema_up (&start->started);
+
+  /* Start the user thread the same way start_process() does. */
+  asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
+  NOT_REACHED ();
+}
+
+/* Terminates the running thread, which must not be its
+   process's main thread, with exit status STATUS. */
+void
+process_thread_exit (int status)
+{
+  struct thread *cur = thread_current ();
+
+  ASSERT (cur->uthread != NULL);
+
+  cur->uthread->status = status;
+  thread_exit ();
+}
+
+/* Waits for thread TID of the current process to exit and
+   returns its exit status, which is -1 if it was killed.
+   Returns -1 at once if TID is not a thread of the current
+   process other than its main thread, if it is the calling
+   thread, or if it is already being joined. */
+int
+process_thread_join (tid_t tid)
+{
+  struct thread *cur = thread_current ();
+  struct thread *leader = cur->leader;
+  struct user_thread *ut = NULL;
+  struct list_elem *e;
+  int status;
+
+  lock_acquire (&leader->uthread_lock);
+  for (e = list_begin (&leader->uthreads); e != list_end (&leader->uthreads);
+       e = list_next (e))
+    {
+      struct user_thread *u = list_entry (e, struct user_thread, elem);
+      if (u->tid == tid && u != cur->uthread && !u->joined)
+        {
+          ut = u;
+          ut->joined = true;
+          break;
+        }
+    }
+  lock_release (&leader->uthread_lock);
+  if (ut == NULL)
+    return -1;
+
+  sema_down (&ut->dead);
+
+  lock_acquire (&leader->uthread_lock);
+  status = ut->status;
+  list_remove (&ut->elem);
+  lock_release (&leader->uthread_lock);
+  free (ut);
+  return status;
+}
+
+/* Returns true if the running thread should exit instead of
+   returning to user mode, because its process is exiting. */
+bool
+process_exiting (void)
+{
+  return thread_current ()->leader->exiting;
+}
+
+/* Marks the current process as exiting with status STATUS,
+   unless it already is, and returns the status it will exit
+   with.  Each of its threads exits the next time it would return
+   to user mode, and the main thread reports the status.  Wakes
+   up threads asleep on the process's futexes for the purpose. */
+int
+process_kill (int status)
+{
+  struct thread *leader = thread_current ()->leader;
+
+  lock_acquire (&leader->uthread_lock);
+  if (!leader->exiting)
+    {
+      leader->exiting = true;
+      leader->exit_status = status;
+    }
+  status = leader->exit_status;
+  lock_release (&leader->uthread_lock);
+  futex_exit (leader);
+  return status;
+}
+
+/* Called by LEADER, the main thread of a process, as it exits:
+   waits for the process's other threads to exit, then frees
+   their join records. */
+static void
+uthreads_stop (struct thread *leader)
+{
+  lock_acquire (&leader->uthread_lock);
+  leader->exiting = true;
+  futex_exit (leader);
+  while (leader->uthread_cnt > 0)
+    cond_wait (&leader->uthreads_done, &leader->uthread_lock);
+  while (!list_empty (&leader->uthreads))
+    free (list_entry (list_pop_front (&leader->uthreads),
+                      struct user_thread, elem));
+  lock_release (&leader->uthread_lock);
+}
+
+/* Releases the user stack of T, which is not its process's main
+   thread, and wakes up any thread joining it.  Also detaches T
+   from the shared page directory, so that process_exit() does
+   not destroy it. */
+static void
+uthread_exit (struct thread *t)
+{
+  struct thread *leader = t->leader;
+  struct user_thread *ut = t->uthread;
+  uint8_t *upage = stack_slot_page (ut->slot);
+  void *kpage;
+
+  lock_acquire (&leader->uthread_lock);
+  kpage = pagedir_get_page (t->pagedir, upage);
+  pagedir_clear_page (t->pagedir, upage);
+  palloc_free_page (kpage);
+  leader->stack_slots &= ~(1u << ut->slot);
+
+  /* Once the leader is signaled it may destroy the page
+     directory, so stop using it first: otherwise, if we were
+     preempted after signaling, process_activate() would load
+     the freed directory when we run again. */
+  t->pagedir = NULL;
+  pagedir_activate (NULL);
+
+  sema_up (&ut->dead);
+  if (--leader->uthread_cnt == 0)
+    cond_broadcast (&leader->uthreads_done, &leader->uthread_lock);
+  lock_release (&leader->uthread_lock);
 }
 
 /* We load ELF binaries.  The following definitions are taken
@@ -445,7 +769,6 @@ load (const char *file_name, void (**eip) (void), void **esp)
 
 /* load() helpers. */
 
-static bool install_page (void *upage, void *kpage, bool writable);
 
 /* Checks whether PHDR describes a valid, loadable segment in
    FILE and returns true if so, false otherwise. */
@@ -578,8 +901,8 @@ setup_stack (void **esp)
    If WRITABLE is true, the user process may modify the page;
    otherwise, it is read-only.
    UPAGE must not already be mapped.
-   KPAGE should probably be a page obtained from the user pool
-   with palloc_get_page().
+   KPAGE should probably be a user page obtained with
+   palloc_get_page(PAL_USER).
    Returns true on success, false if UPAGE is already mapped or
    if memory allocation fails. */
 static bool
@@ -8,4 +8,10 @@ int process_wait (tid_t);
 void process_exit (void);
 void process_activate (void);
 
+tid_t process_thread_create (void (*entry) (void), void *func, void *aux);
+void process_thread_exit (int status) NO_RETURN;
+int process_thread_join (tid_t);
+bool process_exiting (void);
+int process_kill (int status);
+
 #endif /* userprog/process.h */
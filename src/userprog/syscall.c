@@ -1,16 +1,26 @@
 #include "userprog/syscall.h"
 #include <stdio.h>
+#include <string.h>
 #include <syscall-nr.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "threads/synch.h"
+#include "threads/slab.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "threads/init.h"
 #include "devices/timer.h"
+#include "userprog/process.h"
+#include "userprog/futex.h"
 //
-struct lock filesys_lock;
+/* Serializes file system calls.  Calls that only read file data
+   or look up file descriptors hold it for reading, so that they
+   may run at the same time: inode_read_at() changes no shared
+   state.  Two threads reading through one file descriptor at
+   once may still race on its position, as they may in user
+   mode. */
+struct rwlock filesys_lock;
 
 struct process_file{
 	struct file * file;
@@ -18,6 +28,9 @@ struct process_file{
 	struct list_elem elem;
 };
 
+/* Cache that process_file records are allocated from. */
+static struct kmem_cache *process_file_cache;
+
 struct file* get_file_by_fd (int fd);
 struct child_process * get_child_by_tid (int tid);
 ///
@@ -38,23 +51,41 @@ static int my_write(int fd, const void *buffer, unsigned size);
 static void my_seek(int fd, unsigned position);
 static unsigned my_tell(int fd);
 void my_close(int fd);
+static bool my_sched_stats(pid_t pid, struct sched_stats *stats);
+static tid_t my_thread_create(void (*entry) (void), void *func, void *aux);
+static void my_thread_exit(int status);
+static int my_thread_join(tid_t tid);
+static int my_futex_wait(const int *addr, int val);
+static int my_futex_wake(const int *addr, int cnt);
 //-----------------------------
 
+/* Highest system call number. */
+#define SYS_MAX SYS_FUTEX_WAKE
+
 // khg : function pointer && make table by syscall num
 typedef int (*func_p) (int, int, int);
-static func_p syscall_table[SYS_INUMBER+1] =
+static func_p syscall_table[SYS_MAX+1] =
 {
   (func_p)my_halt, (func_p)my_exit, (func_p)my_exec, (func_p)my_wait,
   (func_p)my_create, (func_p)my_remove, (func_p)my_open, (func_p)my_filesize,
   (func_p)my_read, (func_p)my_write, (func_p)my_seek, (func_p)my_tell,
-  (func_p)my_close
+  (func_p)my_close,
+  [SYS_SCHED_STATS] = (func_p)my_sched_stats,
+  [SYS_THREAD_CREATE] = (func_p)my_thread_create,
+  [SYS_THREAD_EXIT] = (func_p)my_thread_exit,
+  [SYS_THREAD_JOIN] = (func_p)my_thread_join,
+  [SYS_FUTEX_WAIT] = (func_p)my_futex_wait,
+  [SYS_FUTEX_WAKE] = (func_p)my_futex_wake
 };
 
 
 void
 syscall_init (void) 
 {
-	lock_init(&filesys_lock);
+	rwlock_init(&filesys_lock);
+  process_file_cache = kmem_cache_create ("process_file",
+                                          sizeof (struct process_file), NULL);
+  futex_init ();
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
 }
 
@@ -80,7 +111,8 @@ syscall_handler (struct intr_frame *f)
 
   call_num = *esp;
   
-  if(call_num < SYS_HALT || call_num > SYS_INUMBER)
+  if(call_num < SYS_HALT || call_num > SYS_MAX
+     || syscall_table[call_num] == NULL)
   {
       my_exit(-1);
   }
@@ -88,7 +120,8 @@ syscall_handler (struct intr_frame *f)
   // I don't know how to check... more good.
   if(call_num == SYS_EXIT || call_num == SYS_EXEC || call_num == SYS_WAIT ||   
      call_num == SYS_OPEN || call_num == SYS_FILESIZE || call_num == SYS_TELL ||
-     call_num == SYS_CLOSE || call_num == SYS_REMOVE)
+     call_num == SYS_CLOSE || call_num == SYS_REMOVE ||
+     call_num == SYS_THREAD_EXIT || call_num == SYS_THREAD_JOIN)
   {
     if(!address_valid(esp + 1))
     {
@@ -96,14 +129,17 @@ syscall_handler (struct intr_frame *f)
     }
       
   }
-  else if(call_num == SYS_CREATE || call_num == SYS_READ || call_num == SYS_SEEK)
+  else if(call_num == SYS_CREATE || call_num == SYS_READ || call_num == SYS_SEEK
+          || call_num == SYS_SCHED_STATS || call_num == SYS_FUTEX_WAIT
+          || call_num == SYS_FUTEX_WAKE)
   {
     if(!address_valid(esp + 1) || !address_valid(esp + 2))
     {
         my_exit(-1);
     }
   }
-  else if(call_num == SYS_READ || call_num == SYS_WRITE)
+  else if(call_num == SYS_READ || call_num == SYS_WRITE ||
+          call_num == SYS_THREAD_CREATE)
   {
     if(!address_valid(esp + 1) || !address_valid(esp + 2) || !address_valid(esp + 3))
     {
@@ -127,19 +163,19 @@ syscall_handler (struct intr_frame *f)
 static int
 my_write (int fd, const void *buffer, unsigned length)
 {
-	lock_acquire(&filesys_lock);
+	rwlock_acquire_write(&filesys_lock);
 	if(!address_valid(buffer)){
-		lock_release(&filesys_lock);
+		rwlock_release_write(&filesys_lock);
 		my_exit(-1);
 	}
   if (fd == STDOUT_FILENO){/* stdout */
   	putbuf (buffer, length);
-		lock_release(&filesys_lock);
+		rwlock_release_write(&filesys_lock);
 		return length;
 	}
 	struct file *fp = get_file_by_fd(fd);
 	if(fp == NULL){
-		lock_release(&filesys_lock);
+		rwlock_release_write(&filesys_lock);
 		return -1;
 	}
     
@@ -155,7 +191,7 @@ my_write (int fd, const void *buffer, unsigned length)
 
     if(check == 0) // same
     {
-        lock_release(&filesys_lock);
+        rwlock_release_write(&filesys_lock);
         return c;
     }
     else
@@ -163,7 +199,7 @@ my_write (int fd, const void *buffer, unsigned length)
 
     
     int byte = file_write(fp, buffer, length);
-	lock_release(&filesys_lock);
+	rwlock_release_write(&filesys_lock);
 	return byte;
 }
 
@@ -171,6 +207,13 @@ void
 my_exit(int status)
 {
     struct thread *cur = thread_current();
+
+    /* Any thread's exit, or its death from a bad pointer or an
+       exception, ends the whole process.  Another thread may have
+       got there first, in which case its status is reported. */
+    status = process_kill(status);
+    if (cur->uthread != NULL)
+        process_thread_exit(status);
     printf("%s: exit(%d)\n", cur->pname, status);
     cur->cp->exit = status;
     cur->cp->wait = false;
@@ -219,34 +262,34 @@ my_wait(pid_t pid)
 static bool
 my_create(const char *file, unsigned initial_size)
 {
-	lock_acquire(&filesys_lock);
+	rwlock_acquire_write(&filesys_lock);
 	
 	if(file == NULL){
-        lock_release(&filesys_lock);
+        rwlock_release_write(&filesys_lock);
         my_exit(-1);
 	}
 	if(!address_valid(file)){
-		lock_release(&filesys_lock);
+		rwlock_release_write(&filesys_lock);
 		my_exit(-1);
 	}
 
 	bool success = filesys_create(file, initial_size);
-	lock_release(&filesys_lock);
+	rwlock_release_write(&filesys_lock);
 	return success;
 }
 static bool
 my_remove(const char *file)
 {
-	lock_acquire(&filesys_lock);
+	rwlock_acquire_write(&filesys_lock);
 	
 	if(file == NULL || !address_valid(file)){
-		lock_release(&filesys_lock);
+		rwlock_release_write(&filesys_lock);
 		return false;
 	}
 
 	bool success = filesys_remove(file);
 
-	lock_release(&filesys_lock);
+	rwlock_release_write(&filesys_lock);
 	return success;
 }
 
@@ -288,23 +331,23 @@ struct Elf32_Phdr
 static int 
 my_open(const char *file)
 {
-	lock_acquire(&filesys_lock);
+	rwlock_acquire_write(&filesys_lock);
 
 	if(file == NULL){
-		lock_release(&filesys_lock);
+		rwlock_release_write(&filesys_lock);
 		return -1;
 	}
 	
 	if(!address_valid(file)){
-		lock_release(&filesys_lock);
+		rwlock_release_write(&filesys_lock);
 		my_exit(-1);
 	}
 
 	struct file *fp = filesys_open(file);
-	int fd = thread_current()->fd;
+	int fd = thread_current()->leader->fd;
 
 	if(!fp){
-		lock_release(&filesys_lock);
+		rwlock_release_write(&filesys_lock);
   //  printf("file open error\n");
     return -1;
 	}
@@ -324,36 +367,36 @@ my_open(const char *file)
 	
 
 
-	struct process_file *pf = malloc(sizeof(struct process_file));
+	struct process_file *pf = kmem_cache_alloc (process_file_cache);
 	pf->file = fp;
 	pf->fd = fd;
-	(thread_current()->fd)++;
-	list_push_back(&thread_current()->file_list, &pf->elem);
+	(thread_current()->leader->fd)++;
+	list_push_back(&thread_current()->leader->file_list, &pf->elem);
 
-	lock_release(&filesys_lock);
+	rwlock_release_write(&filesys_lock);
 
 	return fd;	
 }
 static int 
 my_filesize(int fd)
 {
-	lock_acquire(&filesys_lock);
+	rwlock_acquire_read(&filesys_lock);
 	struct file * fp = get_file_by_fd(fd);
 
 	if(fp == NULL){
-		lock_release(&filesys_lock);
+		rwlock_release_read(&filesys_lock);
 		return -1;
 	}
-	lock_release(&filesys_lock);
+	rwlock_release_read(&filesys_lock);
 	return file_length(fp);
 
 }
 static int 
 my_read(int fd, void *buffer, unsigned size)
 {
-	lock_acquire(&filesys_lock);
+	rwlock_acquire_read(&filesys_lock);
 	if(!address_valid(buffer)){
-		lock_release(&filesys_lock);
+		rwlock_release_read(&filesys_lock);
 		my_exit(-1);
 	}
 	if(fd == STDIN_FILENO){
@@ -361,61 +404,61 @@ my_read(int fd, void *buffer, unsigned size)
 		uint8_t* local_buffer = (uint8_t *)buffer;
 		for(;i< size; i++)
 			local_buffer[i] = input_getc();
-		lock_release(&filesys_lock);
+		rwlock_release_read(&filesys_lock);
 		return size;
 	}
 	
 	struct file * fp = get_file_by_fd(fd);
 	
 	if(!fp){
-		lock_release(&filesys_lock);
+		rwlock_release_read(&filesys_lock);
 		return -1;
 	}
 	
 	int byte = file_read(fp, buffer, size);
-	lock_release(&filesys_lock);
+	rwlock_release_read(&filesys_lock);
 	return byte;
 
 }
 static void 
 my_seek(int fd, unsigned position)
 {
-	lock_acquire(&filesys_lock);
+	rwlock_acquire_write(&filesys_lock);
 	
 	struct file *fp = get_file_by_fd(fd);
 	
 	if(fp == NULL){
-		lock_release(&filesys_lock);
+		rwlock_release_write(&filesys_lock);
 		return;
 	}
 	file_seek(fp, position);
-	lock_release(&filesys_lock);
+	rwlock_release_write(&filesys_lock);
 	return;
 }
 static unsigned
 my_tell(int fd)
 {
-	lock_acquire(&filesys_lock);
+	rwlock_acquire_read(&filesys_lock);
 	
 	struct file * fp = get_file_by_fd(fd);
 
 	if(fd == NULL){
-		lock_release(&filesys_lock);
+		rwlock_release_read(&filesys_lock);
 		return -1;
 	}
 
 	off_t off = file_tell(fp);
 
-	lock_release(&filesys_lock);
+	rwlock_release_read(&filesys_lock);
 	return off;
 }
 
 void
 my_close(int fd)
 {
-	lock_acquire(&filesys_lock);
+	rwlock_acquire_write(&filesys_lock);
 
-	struct thread *t = thread_current();
+	struct thread *t = thread_current()->leader;
 	struct list_elem *e = list_begin(&t->file_list);
 	struct process_file *pf;
 	int count = 0;
@@ -427,7 +470,7 @@ my_close(int fd)
 			file_allow_write(pf->file);
 			file_close(pf->file);
 			list_remove(&pf->elem);
-			free(pf);
+			kmem_cache_free (process_file_cache, pf);
 			count++;
 
             // khg : fd reset....
@@ -438,7 +481,7 @@ my_close(int fd)
         }
 	}
 	
-	lock_release(&filesys_lock);
+	rwlock_release_write(&filesys_lock);
 	
 	if(count == 0 && fd != CLOSE_ALL)
 		my_exit(-1);
@@ -447,7 +490,7 @@ my_close(int fd)
 }
 
 struct file * get_file_by_fd (int fd){
-	struct thread *t = thread_current();
+	struct thread *t = thread_current()->leader;
 	struct list_elem *e = list_begin(&t->file_list);
 	struct process_file *pf;
 	while(e != list_end(&t->file_list)){
@@ -472,3 +515,103 @@ struct child_process * get_child_by_tid (int tid){
 	}
 	return NULL;
 }
+
+/* thread_foreach() helper for my_sched_stats(). */
+struct sched_stats_request
+  {
+    tid_t tid;                  /* Thread to look for. */
+    struct sched_stats *stats;  /* Where to put its statistics. */
+    bool found;                 /* Found it? */
+  };
+
+static void
+sched_stats_visit (struct thread *t, void *req_)
+{
+  struct sched_stats_request *req = req_;
+
+  if (t->tid == req->tid)
+    {
+      thread_get_stats (t, req->stats);
+      req->found = true;
+    }
+}
+
+/* Copies the scheduling statistics of thread PID, or of the
+   calling thread if PID is 0, into *STATS.  Returns false if
+   there is no such thread. */
+static bool
+my_sched_stats (pid_t pid, struct sched_stats *stats)
+{
+  struct sched_stats_request req;
+  struct sched_stats buf;
+  enum intr_level old_level;
+
+  if (!address_valid (stats)
+      || !address_valid ((char *) stats + sizeof *stats - 1))
+    my_exit (-1);
+
+  req.tid = pid != 0 ? pid : thread_tid ();
+  req.stats = &buf;
+  req.found = false;
+  old_level = intr_disable ();
+  thread_foreach (sched_stats_visit, &req);
+  intr_set_level (old_level);
+
+  /* Copy out with interrupts on, in case it faults. */
+  if (req.found)
+    memcpy (stats, &buf, sizeof buf);
+  return req.found;
+}
+
+/* Starts a thread in the current process at user address ENTRY,
+   which is called as ENTRY(FUNC, AUX). */
+static tid_t
+my_thread_create (void (*entry) (void), void *func, void *aux)
+{
+  if (!is_user_vaddr (entry))
+    my_exit (-1);
+  return process_thread_create (entry, func, aux);
+}
+
+/* Terminates the calling thread with STATUS, which is returned
+   to a thread that joins it.  In a process's main thread, the
+   same as exit(STATUS). */
+static void
+my_thread_exit (int status)
+{
+  struct thread *cur = thread_current ();
+
+  if (cur->uthread == NULL)
+    my_exit (status);
+  process_thread_exit (status);
+}
+
+static int
+my_thread_join (tid_t tid)
+{
+  return process_thread_join (tid);
+}
+
+/* Checks that ADDR is a valid, aligned futex address, killing
+   the process if not. */
+static void
+check_futex (const int *addr)
+{
+  if (((uintptr_t) addr & (sizeof *addr - 1)) != 0
+      || !address_valid ((void *) addr))
+    my_exit (-1);
+}
+
+static int
+my_futex_wait (const int *addr, int val)
+{
+  check_futex (addr);
+  return futex_wait (addr, val);
+}
+
+static int
+my_futex_wake (const int *addr, int cnt)
+{
+  check_futex (addr);
+  return futex_wake (addr, cnt);
+}